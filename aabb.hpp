@@ -0,0 +1,55 @@
+#ifndef AABB_HPP
+#define AABB_HPP
+
+#include "ray.hpp"
+#include <algorithm>
+#include <limits>
+
+struct AABB {
+    Vec3 lo = Vec3( std::numeric_limits<Real>::infinity(),
+                    std::numeric_limits<Real>::infinity(),
+                    std::numeric_limits<Real>::infinity());
+    Vec3 hi = Vec3(-std::numeric_limits<Real>::infinity(),
+                   -std::numeric_limits<Real>::infinity(),
+                   -std::numeric_limits<Real>::infinity());
+
+    AABB() = default;
+    AABB(const Vec3& lo, const Vec3& hi): lo(lo), hi(hi) {}
+
+    bool empty() const { return lo.x > hi.x; }
+
+    void expand(const Vec3& p) {
+        lo = Vec3(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+        hi = Vec3(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+    }
+    void expand(const AABB& b) {
+        if (b.empty()) return;
+        expand(b.lo); expand(b.hi);
+    }
+
+    Vec3 centroid() const { return (lo + hi) * 0.5; }
+
+    Real surfaceArea() const {
+        if (empty()) return 0.0;
+        Vec3 d = hi - lo;
+        return 2.0 * (d.x*d.y + d.y*d.z + d.z*d.x);
+    }
+
+    static Real axisOf(const Vec3& v, int axis) {
+        return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+    }
+
+    // slab test against [t_min, t_max]; invDir = 1 / ray.direction (per component)
+    // NaN from 0 * inf leaves the interval untouched, i.e. the test stays conservative
+    bool hit(const Ray& ray, const Vec3& invDir, Real t_min, Real t_max) const {
+        Real t0 = (lo.x - ray.origin.x) * invDir.x, t1 = (hi.x - ray.origin.x) * invDir.x;
+        t_min = std::max(t_min, std::min(t0, t1)); t_max = std::min(t_max, std::max(t0, t1));
+        t0 = (lo.y - ray.origin.y) * invDir.y; t1 = (hi.y - ray.origin.y) * invDir.y;
+        t_min = std::max(t_min, std::min(t0, t1)); t_max = std::min(t_max, std::max(t0, t1));
+        t0 = (lo.z - ray.origin.z) * invDir.z; t1 = (hi.z - ray.origin.z) * invDir.z;
+        t_min = std::max(t_min, std::min(t0, t1)); t_max = std::min(t_max, std::max(t0, t1));
+        return t_min <= t_max;
+    }
+};
+
+#endif // AABB_HPP
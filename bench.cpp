@@ -0,0 +1,351 @@
+// bench.cpp — microbenchmarks for the hot paths (make bench)
+#include "scene.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <random>
+
+// Standalone triangle with its edges and normal precomputed at load time, as
+// the scene stored tris before they moved into the indexed Mesh.
+class Triangle {
+public:
+    Vec3 a;                 // hot: everything intersect() reads sits together at the front
+    Vec3 e1, e2;
+    Vec3 b, c;              // cold: only read for the closest hit
+    Vec3 gn;
+    Vec3 color;
+    Real ua, va, ub, vb, uc, vc;
+    const Texture* tex;
+
+    Triangle(const Vec3& A, const Vec3& B, const Vec3& C, const Vec3& col,
+             Real uA, Real vA, Real uB, Real vB, Real uC, Real vC, const Texture* T)
+        : a(A), e1(B - A), e2(C - A), b(B), c(C), gn(e1.cross(e2).normalized()),
+          color(col), ua(uA), va(vA), ub(uB), vb(vB), uc(uC), vc(vC), tex(T) {}
+
+    std::optional<Hit> intersect(const Ray& ray, Real t_min, Real t_max) const {
+        Real t, u, v;
+        if (!intersectTriangle(ray, a, e1, e2, t_min, t_max, t, u, v)) return std::nullopt;
+        return Hit{ t, u, v };
+    }
+
+    AABB bounds() const {
+        AABB box; box.expand(a); box.expand(b); box.expand(c);
+        return box;
+    }
+};
+
+// Triangle as it was before edges and normal were precomputed at load time:
+// every test rebuilds e1 and e2.
+class LegacyTriangle {
+public:
+    Vec3 a, b, c;
+    LegacyTriangle(const Vec3& A, const Vec3& B, const Vec3& C): a(A), b(B), c(C) {}
+
+    std::optional<Hit> intersect(const Ray& ray, Real t_min, Real t_max) const {
+        constexpr Real EPS = TRI_EPS;
+        Vec3 e1 = b - a, e2 = c - a;
+        Vec3 p  = ray.direction.cross(e2);
+        Real det = e1.dot(p);
+        if (std::fabs(det) < EPS) return std::nullopt;
+        Real invDet = Real(1) / det;
+        Vec3 tvec = ray.origin - a;
+        Real u = tvec.dot(p) * invDet;
+        if (u < -EPS || u > 1.0 + EPS) return std::nullopt;
+        Vec3 qvec = tvec.cross(e1);
+        Real t = e2.dot(qvec) * invDet;
+        if (t <= EPS || t <= t_min || t >= t_max) return std::nullopt;
+        Real v = ray.direction.dot(qvec) * invDet;
+        if (v < -EPS || (u + v) > 1.0 + EPS) return std::nullopt;
+        return Hit{ t, u, v };
+    }
+
+    AABB bounds() const {
+        AABB box; box.expand(a); box.expand(b); box.expand(c);
+        return box;
+    }
+};
+
+// standalone triangles of one type behind a BVH, one test per leaf primitive
+template <class Tri>
+struct TriangleSoup {
+    std::vector<Tri> tris;
+    BVH bvh;
+
+    void build() {
+        std::vector<AABB> boxes(tris.size());
+        std::vector<int> ids(tris.size());
+        for (size_t i = 0; i < tris.size(); ++i) { boxes[i] = tris[i].bounds(); ids[i] = (int)i; }
+        bvh.build(boxes, ids);
+    }
+
+    bool intersect(const Ray& ray) const {
+        Real t_max = std::numeric_limits<Real>::infinity();
+        bool hit = false;
+        bvh.traverse(ray, 0, t_max, [&](int i) {
+            if (auto h = tris[i].intersect(ray, 0, t_max)) { t_max = h->t; hit = true; }
+            return false;
+        });
+        return hit;
+    }
+};
+
+// Bumpy sphere tessellated into 2 * n * n triangles.
+static std::vector<Vec3> meshVertices(int n) {
+    std::vector<Vec3> v;
+    for (int i = 0; i <= n; ++i)
+        for (int j = 0; j <= n; ++j) {
+            double th = M_PI * i / n, ph = 2 * M_PI * j / n;
+            double r = 1.0 + 0.05 * std::sin(7 * th) * std::cos(5 * ph);
+            v.emplace_back(r * std::sin(th) * std::cos(ph), r * std::cos(th), r * std::sin(th) * std::sin(ph));
+        }
+    return v;
+}
+
+template <class Tri, class MakeTri>
+static void fillSoup(TriangleSoup<Tri>& soup, int n, MakeTri make) {
+    std::vector<Vec3> v = meshVertices(n);
+    for (int i = 0; i < n; ++i)
+        for (int j = 0; j < n; ++j) {
+            int a = i * (n + 1) + j, b = a + 1, c = a + n + 1, d = c + 1;
+            soup.tris.push_back(make(v[a], v[c], v[b]));
+            soup.tris.push_back(make(v[b], v[c], v[d]));
+        }
+    soup.build();
+}
+
+// pinhole camera rays in scanline order, framing the mesh
+static std::vector<Ray> makeRays(int res) {
+    std::vector<Ray> rays;
+    rays.reserve((size_t)res * res);
+    Vec3 eye(0, 0, 3);
+    for (int y = 0; y < res; ++y)
+        for (int x = 0; x < res; ++x) {
+            double sx = (2.0 * (x + 0.5) - res) / res, sy = (res - 2.0 * (y + 0.5)) / res;
+            rays.emplace_back(eye, Vec3(sx * 0.5, sy * 0.5, -1));
+        }
+    return rays;
+}
+
+// wall-clock seconds taken by f()
+template <class F>
+static double seconds(F&& f) {
+    auto t0 = std::chrono::steady_clock::now(); f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+template <class Scene_>
+static double raysPerSecond(const Scene_& scene, const std::vector<Ray>& rays, int& hits) {
+    hits = 0;
+    return rays.size() / seconds([&] { for (const Ray& r : rays) if (scene.intersect(r)) ++hits; });
+}
+
+static Triangle makeTriangle(const Vec3& a, const Vec3& b, const Vec3& c) {
+    return Triangle(a, b, c, Vec3(1,1,1), 0,0, 0,0, 0,0, nullptr);
+}
+
+static void benchTriangle() {
+    const int n = 400;  // 320k triangles
+    const std::vector<Ray> rays = makeRays(1000);
+
+    TriangleSoup<LegacyTriangle> before;
+    TriangleSoup<Triangle> after;
+    fillSoup(before, n, [](const Vec3& a, const Vec3& b, const Vec3& c) { return LegacyTriangle(a, b, c); });
+    fillSoup(after, n, makeTriangle);
+
+    int hb, ha;
+    double rb = raysPerSecond(before, rays, hb);
+    double ra = raysPerSecond(after,  rays, ha);
+    std::printf("triangle: %zu tris, %zu rays\n", after.tris.size(), rays.size());
+    std::printf("  per-ray edges  %8.2f Mrays/s  (%d hits)\n", rb / 1e6, hb);
+    std::printf("  precomputed    %8.2f Mrays/s  (%d hits)  x%.2f\n", ra / 1e6, ha, ra / rb);
+}
+
+// the same mesh as one indexed Mesh sharing its vertex pool
+static void fillIndexedMesh(Scene& scene, int n) {
+    scene.mesh.vertices = meshVertices(n);
+    scene.mesh.uvs.assign(scene.mesh.vertices.size(), { 0.0, 0.0 });
+    for (int i = 0; i < n; ++i)
+        for (int j = 0; j < n; ++j) {
+            int a = i * (n + 1) + j, b = a + 1, c = a + n + 1, d = c + 1;
+            scene.mesh.addTriangle(a, c, b, Vec3(1,1,1), nullptr);
+            scene.mesh.addTriangle(b, c, d, Vec3(1,1,1), nullptr);
+        }
+    scene.buildAccel();
+}
+
+static void benchMesh() {
+    const int n = 400;
+    const std::vector<Ray> rays = makeRays(1000);
+
+    TriangleSoup<Triangle> soup;
+    Scene indexed;
+    fillSoup(soup, n, makeTriangle);
+    fillIndexedMesh(indexed, n);
+
+    // geometry bytes only; both sides pay about the same for their BVH
+    const Mesh& m = indexed.mesh;
+    size_t bo = soup.tris.size() * sizeof(Triangle);
+    size_t bi = m.vertices.size() * (sizeof(Vec3) + sizeof(m.uvs[0])) + m.tris.size() * sizeof(MeshTri)
+              + m.blocks.size() * sizeof(TriBlock);
+
+    int ho, hi;
+    double ro = raysPerSecond(soup, rays, ho);
+    double ri = raysPerSecond(indexed, rays, hi);
+    std::printf("mesh: %zu tris, %zu rays\n", m.tris.size(), rays.size());
+    std::printf("  Triangle array   %8.2f Mrays/s  (%d hits)  %7.1f MB\n", ro / 1e6, ho, bo / 1e6);
+    std::printf("  indexed Mesh     %8.2f Mrays/s  (%d hits)  %7.1f MB\n", ri / 1e6, hi, bi / 1e6);
+}
+
+// primary visibility on the indexed mesh: rays one by one vs 4x4 pixel packets
+static void benchPacket() {
+    const int n = 400, res = 1000;
+    const std::vector<Ray> rays = makeRays(res);
+    Scene scene;
+    fillIndexedMesh(scene, n);
+
+    int hs;
+    double rs = raysPerSecond(scene, rays, hs);
+
+    int hp = 0;
+    std::optional<HitInfo> out[RayPacket::SIZE];
+    double rp = rays.size() / seconds([&] {
+        for (int by = 0; by < res; by += 4)
+            for (int bx = 0; bx < res; bx += 4) {
+                RayPacket packet;
+                for (int y = by; y < std::min(by + 4, res); ++y)
+                    for (int x = bx; x < std::min(bx + 4, res); ++x) packet.add(rays[(size_t)y * res + x]);
+                scene.intersect(packet, out);
+                for (int i = 0; i < packet.count; ++i) if (out[i]) ++hp;
+            }
+    });
+
+    std::printf("packet: %zu tris, %zu rays\n", scene.mesh.tris.size(), rays.size());
+    std::printf("  single rays      %8.2f Mrays/s  (%d hits)\n", rs / 1e6, hs);
+    std::printf("  4x4 packets      %8.2f Mrays/s  (%d hits)  x%.2f\n", rp / 1e6, hp, rp / rs);
+}
+
+// Scene::loadFromFile as it was: getline, one istringstream per line and a
+// chain of string compares; geometry commands only, that is all the file has
+static void legacyLoad(Scene& scene, const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty()) continue;
+        std::istringstream iss(line);
+        std::string cmd; iss >> cmd;
+        if (cmd.empty()) continue;
+        if (cmd == "png") { iss >> scene.width >> scene.height >> scene.filename; }
+        else if (cmd == "color") { double r,g,b; iss >> r >> g >> b; scene.current_color = Vec3(r,g,b); }
+        else if (cmd == "texcoord") { iss >> scene.cur_u >> scene.cur_v; }
+        else if (cmd == "xyz") {
+            double x,y,z; iss >> x >> y >> z;
+            scene.mesh.vertices.emplace_back(x,y,z);
+            scene.mesh.uvs.emplace_back(scene.cur_u, scene.cur_v);
+        }
+        else if (cmd == "tri") {
+            int i,j,k; iss >> i >> j >> k;
+            auto idx = [&](int k){ return k > 0 ? k-1 : (int)scene.mesh.vertices.size() + k; };
+            scene.mesh.addTriangle(idx(i), idx(j), idx(k), scene.current_color, scene.current_tex);
+        }
+    }
+}
+
+// synthetic million-triangle scene: a bumpy grid, texcoord per vertex, a color per row
+// grid size of the scene file the parse and load benches share: 1.0M triangles
+static constexpr int SCENE_FILE_GRID = 708;
+
+static std::string writeSceneFile(int n) {
+    std::string path = (std::filesystem::temp_directory_path() / "bench_scene.txt").string();
+    std::FILE* f = std::fopen(path.c_str(), "w");
+    std::fprintf(f, "png 512 512 bench.png\neye 0 0 3\nsun 1 1 1\n");
+    std::vector<Vec3> v = meshVertices(n);
+    for (int i = 0; i <= n; ++i)
+        for (int j = 0; j <= n; ++j) {
+            const Vec3& p = v[i * (n + 1) + j];
+            std::fprintf(f, "texcoord %.6g %.6g\nxyz %.9g %.9g %.9g\n", (double)j / n, (double)i / n, p.x, p.y, p.z);
+        }
+    for (int i = 0; i < n; ++i) {
+        std::fprintf(f, "color %.3f 0.5 %.3f\n", (double)i / n, 1.0 - (double)i / n);
+        for (int j = 0; j < n; ++j) {
+            int a = i * (n + 1) + j + 1, b = a + 1, c = a + n + 1, d = c + 1;
+            std::fprintf(f, "tri %d %d %d\ntri %d %d %d\n", a, c, b, b, c, d);
+        }
+    }
+    std::fclose(f);
+    return path;
+}
+
+static void benchParse() {
+    const std::string path = writeSceneFile(SCENE_FILE_GRID);
+    const double mb = std::filesystem::file_size(path) / 1e6;
+
+    Scene before, read, mapped, parallel;
+    const int threads = WorkStealingPool::defaultThreads();
+    double tb = seconds([&] { legacyLoad(before, path); });
+    // parse only; loadFromFile would also build the BVH
+    double tr = seconds([&] { read.readFile(path); });
+    double tm = seconds([&] {
+        MappedFile map;
+        if (map.open(path)) mapped.parse(map.data(), map.data() + map.size());
+    });
+    double tp = seconds([&] {
+        MappedFile map;
+        if (map.open(path)) parallel.parseParallel(map.data(), map.data() + map.size(), threads);
+    });
+    auto same = [&](const Scene& a, const Scene& b) {
+        bool ok = a.mesh.vertices.size() == b.mesh.vertices.size() && a.mesh.tris.size() == b.mesh.tris.size() &&
+                  a.mesh.materials.size() == b.mesh.materials.size();
+        for (size_t i = 0; ok && i < a.mesh.vertices.size(); ++i)
+            ok = a.mesh.vertices[i].x == b.mesh.vertices[i].x && a.mesh.uvs[i] == b.mesh.uvs[i];
+        for (size_t i = 0; ok && i < a.mesh.tris.size(); ++i)
+            ok = std::equal(a.mesh.tris[i].v, a.mesh.tris[i].v + 3, b.mesh.tris[i].v) &&
+                 a.mesh.tris[i].material == b.mesh.tris[i].material;
+        return ok;
+    };
+
+    std::printf("parse: %.1f MB, %zu tris%s\n", mb, mapped.mesh.tris.size(),
+                same(before, read) && same(before, mapped) && same(before, parallel) ? "" : "  MISMATCH");
+    std::printf("  istringstream    %8.1f MB/s  (%.2f s)\n", mb / tb, tb);
+    std::printf("  tokenizer, read  %8.1f MB/s  (%.2f s)  x%.1f\n", mb / tr, tr, tb / tr);
+    std::printf("  tokenizer, mmap  %8.1f MB/s  (%.2f s)  x%.1f\n", mb / tm, tm, tb / tm);
+    std::printf("  parallel, %2d thr %8.1f MB/s  (%.2f s)  x%.1f\n", threads, mb / tp, tp, tb / tp);
+    std::remove(path.c_str());
+}
+
+// full startup: parse and BVH build vs mapping the compiled cache
+static void benchLoad() {
+    const std::string path = writeSceneFile(SCENE_FILE_GRID);
+    Scene text, cached;
+    double tt = seconds([&] { text.loadText(path); });
+    text.saveCache(path);
+    const double mb = std::filesystem::file_size(Scene::cachePath(path)) / 1e6;
+    bool hit = false;
+    double tc = seconds([&] { hit = cached.loadCache(path); });
+
+    bool ok = hit && cached.mesh.tris.size() == text.mesh.tris.size() &&
+              std::equal(text.mesh.bvh.nodes.begin(), text.mesh.bvh.nodes.end(), cached.mesh.bvh.nodes.begin(),
+                         [](const BVHNode& x, const BVHNode& y) { return x.first == y.first && x.count == y.count; });
+    std::printf("load: %zu tris, %.1f MB cache%s\n", text.mesh.tris.size(), mb, ok ? "" : "  MISMATCH");
+    std::printf("  parse + build    %8.3f s\n", tt);
+    std::printf("  mapped cache     %8.3f s  x%.0f\n", tc, tt / tc);
+    std::remove(Scene::cachePath(path).c_str());
+    std::remove(path.c_str());
+}
+
+int main(int argc, char** argv) {
+    struct Bench { const char* name; std::function<void()> run; };
+    const Bench benches[] = {
+        { "triangle", benchTriangle },
+        { "mesh",     benchMesh },
+        { "packet",   benchPacket },
+        { "parse",    benchParse },
+        { "load",     benchLoad },
+    };
+    for (const auto& b : benches)
+        if (argc < 2 || !std::strcmp(argv[1], b.name)) b.run();
+    return 0;
+}
@@ -0,0 +1,252 @@
+// bvh.hpp — binned SAH bounding volume hierarchy over a list of primitive boxes
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include "aabb.hpp"
+#include "packet.hpp"
+#include "flat_array.hpp"
+#include <vector>
+
+struct BVHNode {
+    AABB box;
+    int first = 0;  // leaf: offset into BVH::prims; inner: left child (right child = first + 1)
+    int count = 0;  // leaf: primitive count; inner: 0
+    int axis  = 0;  // inner: split axis, used to visit the near child first
+};
+
+// Nodes refer to each other and to prims by index only, so both arrays are
+// position independent: a cache can store them as they are and map them back.
+class BVH {
+public:
+    FlatArray<BVHNode> nodes;
+    FlatArray<int>     prims;  // primitive ids in leaf order
+
+    static constexpr int    BINS          = 16;
+    static constexpr int    MAX_LEAF      = 4;
+    // deepest leaf the builder makes; a walk then holds at most MAX_DEPTH + 1 entries
+    static constexpr int    MAX_DEPTH     = 63;
+    static constexpr double TRAVERSE_COST = 1.0;  // relative to one primitive test
+
+    bool empty() const { return nodes.empty(); }
+
+    // boxes[i] bounds primitive ids[i]; ids are what traverse() hands back to the caller.
+    // batch > 1 tells the SAH that a leaf tests that many primitives for the price of one.
+    void build(const std::vector<AABB>& boxes, const std::vector<int>& ids, int batch = 1) {
+        nodes = std::vector<BVHNode>(); prims = std::vector<int>();
+        this->batch = std::clamp(batch, 1, MAX_LEAF);
+        if (boxes.empty()) return;
+
+        std::vector<Item> items(boxes.size());
+        for (size_t i = 0; i < boxes.size(); ++i)
+            items[i] = Item{ boxes[i], boxes[i].centroid(), ids[i] };
+
+        tree.reserve(2 * items.size());
+        tree.emplace_back();
+        // depth-first like a recursive build, so each left subtree is laid out
+        // before its right sibling, but without recursion
+        std::vector<Task> todo{ Task{ 0, 0, (int)items.size(), 0 } };
+        while (!todo.empty()) {
+            const Task t = todo.back(); todo.pop_back();
+            buildNode(t, items, todo);
+        }
+        nodes = std::move(tree);
+        tree = std::vector<BVHNode>();
+
+        std::vector<int> order(items.size());
+        for (size_t i = 0; i < items.size(); ++i) order[i] = items[i].id;
+        prims = std::move(order);
+    }
+
+    // Visits every leaf primitive whose node box overlaps [t_min, t_max], near child first.
+    // leaf(id) may shrink t_max (closest hit) and returns true to stop early (any hit).
+    template <class Leaf>
+    bool traverse(const Ray& ray, Real t_min, Real& t_max, Leaf&& leaf) const {
+        return traverseLeaves(ray, t_min, t_max, [&](int ni) {
+            const BVHNode& node = nodes[ni];
+            for (int i = node.first; i < node.first + node.count; ++i)
+                if (leaf(prims[i])) return true;
+            return false;
+        });
+    }
+
+    // Same walk, but hands over whole leaves by node index, for callers that
+    // test a leaf's primitives together.
+    template <class Leaf>
+    bool traverseLeaves(const Ray& ray, Real t_min, Real& t_max, Leaf&& leaf) const {
+        if (nodes.empty()) return false;
+        const Vec3 inv(Real(1) / ray.direction.x, Real(1) / ray.direction.y, Real(1) / ray.direction.z);
+        const bool neg[3] = { inv.x < 0, inv.y < 0, inv.z < 0 };
+
+        int stack[MAX_DEPTH + 1]; int sp = 0;
+        stack[sp++] = 0;
+        while (sp > 0) {
+            const int ni = stack[--sp];
+            const BVHNode& node = nodes[ni];
+            if (!node.box.hit(ray, inv, t_min, t_max)) continue;
+
+            if (node.count > 0) {
+                if (leaf(ni)) return true;
+            } else {
+                // push the far child first so the near one is popped next
+                int nearChild = neg[node.axis] ? node.first + 1 : node.first;
+                int farChild  = neg[node.axis] ? node.first     : node.first + 1;
+                stack[sp++] = farChild;
+                stack[sp++] = nearChild;
+            }
+        }
+        return false;
+    }
+
+    // Packet walk for a coherent RayPacket: each node box is tested once for all
+    // active rays and the walk carries on with the lanes that hit it. Every ray
+    // sees the same nodes in the same order as with traverseLeaves(), so results
+    // match single-ray tracing exactly. leaf(node, mask) may shrink t_max[lane].
+    template <class Leaf>
+    void traversePacket(const RayPacket& p, Real t_min, Real t_max[], unsigned active, Leaf&& leaf) const {
+        if (nodes.empty() || !active) return;
+        const bool neg[3] = { p.ix[0] < 0, p.iy[0] < 0, p.iz[0] < 0 };
+
+        struct Entry { int node; unsigned mask; };
+        Entry stack[MAX_DEPTH + 1]; int sp = 0;
+        stack[sp++] = { 0, active };
+        while (sp > 0) {
+            const Entry e = stack[--sp];
+            const BVHNode& node = nodes[e.node];
+            const unsigned mask = p.hits(node.box, t_min, t_max, e.mask);
+            if (!mask) continue;
+
+            if (node.count > 0) {
+                leaf(e.node, mask);
+            } else {
+                int nearChild = neg[node.axis] ? node.first + 1 : node.first;
+                int farChild  = neg[node.axis] ? node.first     : node.first + 1;
+                stack[sp++] = { farChild, mask };
+                stack[sp++] = { nearChild, mask };
+            }
+        }
+    }
+
+    // Structural check for trees that did not come from build() (a loaded
+    // cache): every index in range, children after their parent (so walks
+    // terminate), leaves no deeper than MAX_DEPTH and at most MAX_LEAF wide.
+    bool wellFormed(size_t primCount) const {
+        const size_t n = nodes.size();
+        std::vector<int> depth(n, 0);
+        for (size_t ni = 0; ni < n; ++ni) {
+            const BVHNode& node = nodes[ni];
+            if (node.count < 0 || node.count > MAX_LEAF || node.first < 0) return false;
+            if (node.count > 0) {
+                if ((size_t)node.first + node.count > prims.size()) return false;
+            } else {
+                if ((size_t)node.first <= ni || (size_t)node.first + 1 >= n || node.axis < 0 || node.axis > 2) return false;
+                if (depth[ni] >= MAX_DEPTH) return false;
+                for (int c = 0; c < 2; ++c) depth[node.first + c] = std::max(depth[node.first + c], depth[ni] + 1);
+            }
+        }
+        for (int id : prims) if (id < 0 || (size_t)id >= primCount) return false;
+        return true;
+    }
+
+private:
+    struct Item { AABB box; Vec3 c; int id; };
+    struct Task { int node, begin, end, depth; };
+    int batch = 1;
+    std::vector<BVHNode> tree;  // nodes while build() runs
+
+    double testCost(int n) const { return (double)((n + batch - 1) / batch); }
+
+    // levels a chain of halving splits needs to get n items down to one each
+    static int halvings(int n) { int d = 0; while ((1 << d) < n) ++d; return d; }
+
+    void buildNode(const Task& task, std::vector<Item>& items, std::vector<Task>& todo) {
+        const int ni = task.node, begin = task.begin, end = task.end;
+        AABB box, cbox;
+        for (int i = begin; i < end; ++i) { box.expand(items[i].box); cbox.expand(items[i].c); }
+        tree[ni].box = box;
+
+        const int n = end - begin;
+        if (n <= 1) { makeLeaf(ni, begin, n); return; }
+
+        // near the depth limit: median splits on the widest centroid axis, which
+        // are sure to bottom out within it (chains of lopsided SAH splits are not)
+        if (task.depth + halvings(n) >= MAX_DEPTH) {
+            if (n <= MAX_LEAF) { makeLeaf(ni, begin, n); return; }
+            Vec3 ext = cbox.hi - cbox.lo;
+            int axis = ext.x >= ext.y && ext.x >= ext.z ? 0 : (ext.y >= ext.z ? 1 : 2);
+            std::nth_element(items.begin() + begin, items.begin() + begin + n / 2, items.begin() + end,
+                             [&](const Item& a, const Item& b) { return AABB::axisOf(a.c, axis) < AABB::axisOf(b.c, axis); });
+            splitAt(task, begin + n / 2, axis, todo);
+            return;
+        }
+
+        // pick the cheapest binned SAH split over all three axes
+        int bestAxis = -1, bestBin = -1;
+        double bestCost = std::numeric_limits<double>::infinity();
+        for (int axis = 0; axis < 3; ++axis) {
+            double cmin = AABB::axisOf(cbox.lo, axis), cmax = AABB::axisOf(cbox.hi, axis);
+            if (cmax - cmin < 1e-12) continue;
+            double scale = BINS / (cmax - cmin);
+
+            AABB binBox[BINS]; int binCount[BINS] = {};
+            for (int i = begin; i < end; ++i) {
+                int b = binOf(AABB::axisOf(items[i].c, axis), cmin, scale);
+                binBox[b].expand(items[i].box); ++binCount[b];
+            }
+
+            // sweep right-to-left for suffix areas, then left-to-right for the cost
+            double rightArea[BINS]; int rightCount[BINS];
+            AABB acc; int cnt = 0;
+            for (int b = BINS - 1; b > 0; --b) {
+                acc.expand(binBox[b]); cnt += binCount[b];
+                rightArea[b] = acc.surfaceArea(); rightCount[b] = cnt;
+            }
+            acc = AABB(); cnt = 0;
+            for (int b = 0; b < BINS - 1; ++b) {
+                acc.expand(binBox[b]); cnt += binCount[b];
+                if (cnt == 0 || rightCount[b+1] == 0) continue;
+                double cost = acc.surfaceArea() * testCost(cnt) + rightArea[b+1] * testCost(rightCount[b+1]);
+                if (cost < bestCost) { bestCost = cost; bestAxis = axis; bestBin = b; }
+            }
+        }
+
+        double parentArea = box.surfaceArea();
+        double leafCost   = testCost(n);
+        double splitCost  = parentArea > 0 ? TRAVERSE_COST + bestCost / parentArea : leafCost;
+        if (bestAxis < 0 || (n <= MAX_LEAF && splitCost >= leafCost)) {
+            if (bestAxis < 0 && n > MAX_LEAF) {
+                // all centroids coincide: split by count so the leaves stay small
+                splitAt(task, begin + n / 2, 0, todo);
+                return;
+            }
+            makeLeaf(ni, begin, n);
+            return;
+        }
+
+        double cmin  = AABB::axisOf(cbox.lo, bestAxis);
+        double scale = BINS / (AABB::axisOf(cbox.hi, bestAxis) - cmin);
+        auto it = std::partition(items.begin() + begin, items.begin() + end, [&](const Item& it) {
+            return binOf(AABB::axisOf(it.c, bestAxis), cmin, scale) <= bestBin;
+        });
+        splitAt(task, (int)(it - items.begin()), bestAxis, todo);
+    }
+
+    // right child queued first so the left one is built next
+    void splitAt(const Task& t, int mid, int axis, std::vector<Task>& todo) {
+        int left = (int)tree.size();
+        tree.emplace_back(); tree.emplace_back();
+        tree[t.node].first = left; tree[t.node].count = 0; tree[t.node].axis = axis;
+        todo.push_back(Task{ left + 1, mid,     t.end, t.depth + 1 });
+        todo.push_back(Task{ left,     t.begin, mid,   t.depth + 1 });
+    }
+
+    void makeLeaf(int ni, int begin, int n) {
+        tree[ni].first = begin; tree[ni].count = n;
+    }
+
+    static int binOf(double c, double cmin, double scale) {
+        int b = (int)((c - cmin) * scale);
+        return std::clamp(b, 0, BINS - 1);
+    }
+};
+
+#endif // BVH_HPP
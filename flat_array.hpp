@@ -0,0 +1,64 @@
+// flat_array.hpp — read-only contiguous array that either owns its elements or
+// views them in place, e.g. inside a mapped scene cache
+#ifndef FLAT_ARRAY_HPP
+#define FLAT_ARRAY_HPP
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Readers see a plain pointer + size either way, so code that walks the array
+// does not care where it lives. A view does not keep its memory alive; the
+// owner of the mapping has to outlive it.
+template <class T>
+class FlatArray {
+public:
+    FlatArray() = default;
+    FlatArray(const FlatArray& o) { *this = o; }
+    FlatArray(FlatArray&& o) noexcept { *this = std::move(o); }
+
+    FlatArray& operator=(const FlatArray& o) {
+        if (this != &o) { items = o.items; point(o.mapped() ? o.ptr : items.data(), o.len); }
+        return *this;
+    }
+    FlatArray& operator=(FlatArray&& o) noexcept {
+        if (this != &o) {
+            const T* p = o.mapped() ? o.ptr : nullptr;
+            items = std::move(o.items);
+            point(p ? p : items.data(), o.len);
+            o.items.clear(); o.point(nullptr, 0);
+        }
+        return *this;
+    }
+
+    // takes ownership of v
+    FlatArray& operator=(std::vector<T>&& v) {
+        items = std::move(v);
+        point(items.data(), items.size());
+        return *this;
+    }
+
+    // n elements at p, not owned
+    void view(const T* p, size_t n) {
+        items = std::vector<T>();
+        point(p, n);
+    }
+
+    bool mapped() const { return ptr != items.data(); }
+
+    const T* data() const { return ptr; }
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+    const T& operator[](size_t i) const { return ptr[i]; }
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + len; }
+
+private:
+    std::vector<T> items;
+    const T* ptr = nullptr;
+    size_t len = 0;
+
+    void point(const T* p, size_t n) { ptr = p; len = n; }
+};
+
+#endif // FLAT_ARRAY_HPP
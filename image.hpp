@@ -6,34 +6,98 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <limits>
+
+// Exact linear -> sRGB byte encoder without pow() per call.
+// byte(v) is the number of thresholds T[1..255] that v reaches; a 4096-bucket
+// table gives the byte at each bucket start, and since the curve never climbs
+// more than one byte per bucket at most one threshold check follows.
+class SRGBEncoder {
+public:
+    static constexpr int BUCKETS = 4096;
+
+    static unsigned char reference(double v) {
+        v = std::clamp(v, 0.0, 1.0);
+        double s = (v <= 0.0031308) ? (12.92*v) : (1.055*std::pow(v, 1.0/2.4) - 0.055);
+        int iv = (int)std::lround(s * 255.0);
+        return (unsigned char)std::clamp(iv, 0, 255);
+    }
+
+    static const SRGBEncoder& get() { static const SRGBEncoder enc; return enc; }
+
+    unsigned char encode(float v) const {
+        v = std::clamp(v, 0.0f, 1.0f);
+        int i = std::min((int)(v * BUCKETS), BUCKETS - 1);
+        int b = base[i];
+        while (b < 255 && v >= threshold[b + 1]) ++b;
+        return (unsigned char)b;
+    }
+
+private:
+    std::array<float, 257> threshold;          // threshold[k]: smallest float with byte >= k
+    std::array<unsigned char, BUCKETS> base;
+
+    SRGBEncoder() {
+        threshold[0] = -std::numeric_limits<float>::infinity();
+        for (int k = 1; k <= 255; ++k) {
+            // bisect on doubles for the first v with reference(v) >= k ...
+            double lo = 0.0, hi = 1.0;
+            for (int it = 0; it < 64 && std::nextafter(lo, hi) < hi; ++it) {
+                double mid = 0.5 * (lo + hi);
+                if (reference(mid) >= k) hi = mid; else lo = mid;
+            }
+            // ... then round up to the first float that reaches it
+            float f = (float)hi;
+            while (f > 0.0f && reference(std::nextafter(f, 0.0f)) >= k) f = std::nextafter(f, 0.0f);
+            while (reference(f) < k) f = std::nextafter(f, 2.0f);
+            threshold[k] = f;
+        }
+        threshold[256] = std::numeric_limits<float>::infinity();
+        for (int i = 0; i < BUCKETS; ++i) base[i] = reference((float)i / BUCKETS);
+    }
+};
 
 class Image {
     int w, h, ch;
     std::vector<unsigned char> pixels; // RGBA
+    // linear RGB accumulated by setLinear; NaN marks pixels already written as bytes
+    std::vector<float> linear;
 public:
-    Image(int width, int height): w(width), h(height), ch(4), pixels(width*height*4, 0) {}
+    Image(int width, int height): w(width), h(height), ch(4), pixels(width*height*4, 0),
+        linear((size_t)width*height*3, std::numeric_limits<float>::quiet_NaN()) {}
 
     void setRGBA(int x, int y, unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
         int idx = (y * w + x) * ch;
         pixels[idx+0]=r; pixels[idx+1]=g; pixels[idx+2]=b; pixels[idx+3]=a;
+        linear[(size_t)(y * w + x) * 3] = std::numeric_limits<float>::quiet_NaN();
     }
 
+    // stores linear color; conversion to sRGB bytes happens in one pass in quantize()
     void setLinear(int x, int y, double lr, double lg, double lb, unsigned char a) {
-        auto toByteSRGB = [](double v)->unsigned char {
-            v = std::clamp(v, 0.0, 1.0);
-            double s = (v <= 0.0031308) ? (12.92*v) : (1.055*std::pow(v, 1.0/2.4) - 0.055);
-            int iv = (int)std::lround(s * 255.0);
-            return (unsigned char)std::clamp(iv, 0, 255);
-        };
-        int idx = (y * w + x) * ch;
-        pixels[idx+0]=toByteSRGB(lr);
-        pixels[idx+1]=toByteSRGB(lg);
-        pixels[idx+2]=toByteSRGB(lb);
-        pixels[idx+3]=a; // alpha 不做 gamma
+        size_t li = (size_t)(y * w + x) * 3;
+        linear[li+0]=(float)lr; linear[li+1]=(float)lg; linear[li+2]=(float)lb;
+        pixels[(y * w + x) * ch + 3]=a; // alpha 不做 gamma
+    }
+
+    // encode every linear pixel to sRGB bytes, scanline by scanline
+    void quantize() {
+        const SRGBEncoder& enc = SRGBEncoder::get();
+        for (int y = 0; y < h; ++y) {
+            const float* src = &linear[(size_t)y * w * 3];
+            unsigned char* dst = &pixels[(size_t)y * w * ch];
+            for (int x = 0; x < w; ++x, src += 3, dst += ch) {
+                if (std::isnan(src[0])) continue;
+                dst[0] = enc.encode(src[0]);
+                dst[1] = enc.encode(src[1]);
+                dst[2] = enc.encode(src[2]);
+            }
+        }
     }
 
     void save(const std::string& filename) {
+        quantize();
         stbi_write_png(filename.c_str(), w, h, ch, pixels.data(), w*ch);
     }
 };
@@ -1,18 +1,45 @@
 #include "scene.hpp"
 #include "renderer.hpp"
+#include <cstring>
 
 
 int main(int argc, char** argv) {
-    if (argc != 2) {
-        std::cerr << "Usage: ./raytracer <scene.txt>\n";
+    const char* path = nullptr;
+    int threads = WorkStealingPool::defaultThreads();
+    Renderer::Mode mode = Renderer::Mode::Packet;
+    bool compile = false;
+    for (int i = 1; i < argc; ++i) {
+        if ((!std::strcmp(argv[i], "-t") || !std::strcmp(argv[i], "--threads")) && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--single")) {
+            mode = Renderer::Mode::Single;   // no ray packets, for comparison
+        } else if (!std::strcmp(argv[i], "--wavefront")) {
+            mode = Renderer::Mode::Wavefront;
+        } else if (!std::strcmp(argv[i], "--compile")) {
+            compile = true;   // write <scene.txt>.rtc and exit
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            path = nullptr; break;
+        }
+    }
+    if (!path || threads < 1) {
+        std::cerr << "Usage: ./raytracer <scene.txt> [-t threads] [--single | --wavefront] [--compile]\n";
         return 1;
     }
     Scene scene;
-    if (!scene.loadFromFile(argv[1])) {
+    if (!(compile ? scene.loadText(path, threads) : scene.loadFromFile(path, threads))) {
         std::cerr << "Failed to load scene." << std::endl;
         return 1;
     }
-    Renderer renderer(scene);
+    if (compile) {
+        if (!scene.saveCache(path)) {
+            std::cerr << "Failed to write " << Scene::cachePath(path) << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    Renderer renderer(scene, threads, mode);
     renderer.render();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,67 @@
+// mapped_file.hpp — read-only memory map of a whole file (POSIX), empty elsewhere
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_MMAP 1
+#endif
+
+// The pages come straight from the OS page cache, so nothing is copied and a
+// second render of the same file reads it from memory. open() fails (and the
+// caller falls back to reading) for missing, empty or unmappable files.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& o) noexcept { *this = std::move(o); }
+    MappedFile& operator=(MappedFile&& o) noexcept {
+        if (this != &o) { close(); std::swap(ptr, o.ptr); std::swap(len, o.len); }
+        return *this;
+    }
+    ~MappedFile() { close(); }
+
+    // sequential: read once front to back (scene text); otherwise the kernel's
+    // default read-ahead is kept, which suits random access like BVH traversal
+    bool open(const std::string& path, bool sequential = true) {
+        close();
+#if defined(MAPPED_FILE_MMAP)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                ptr = (const char*)p; len = (size_t)st.st_size;
+                if (sequential) madvise(p, len, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);   // the mapping stays valid
+#endif
+        return ptr != nullptr;
+    }
+
+    void close() {
+#if defined(MAPPED_FILE_MMAP)
+        if (ptr) munmap((void*)ptr, len);
+#endif
+        ptr = nullptr; len = 0;
+    }
+
+    const char* data() const { return ptr; }
+    size_t size() const { return len; }
+
+private:
+    const char* ptr = nullptr;
+    size_t len = 0;
+};
+
+#endif // MAPPED_FILE_HPP
@@ -0,0 +1,174 @@
+// mesh.hpp — indexed triangle mesh: shared vertex/UV pool, compact index array, own BVH
+#ifndef MESH_HPP
+#define MESH_HPP
+
+#include "object.hpp"
+#include "triangle.hpp"
+#include "triblock.hpp"
+#include "bvh.hpp"
+#include <vector>
+
+struct MeshMaterial {
+    Vec3 color;
+    const Texture* tex;  // owned by Scene::textures
+};
+
+struct MeshTri {
+    int v[3];      // indices into Mesh::vertices / Mesh::uvs
+    int material;  // index into Mesh::materials
+};
+
+class Mesh {
+public:
+    std::vector<Vec3> vertices;
+    std::vector<std::pair<Real,Real>> uvs;      // one per vertex
+    std::vector<MeshTri> tris;
+    std::vector<MeshMaterial> materials;
+    BVH bvh;
+
+    // SoA copy of each leaf's triangles for the SIMD kernel; leafBlock maps node -> block.
+    // Like the BVH arrays these may be views into a mapped scene cache.
+    FlatArray<TriBlock> blocks;
+    FlatArray<int> leafBlock;
+    static_assert(BVH::MAX_LEAF <= TriBlock::LANES, "a leaf must fit in one block");
+
+    // consecutive triangles usually share color/texture, so only a change adds a material
+    void addTriangle(int ia, int ib, int ic, const Vec3& color, const Texture* tex) {
+        if (materials.empty() || materials.back().tex != tex ||
+            materials.back().color.x != color.x ||
+            materials.back().color.y != color.y ||
+            materials.back().color.z != color.z) {
+            materials.push_back(MeshMaterial{ color, tex });
+        }
+        tris.push_back(MeshTri{ { ia, ib, ic }, (int)materials.size() - 1 });
+    }
+
+    void build() {
+        std::vector<AABB> boxes(tris.size());
+        std::vector<int> ids(tris.size());
+        for (size_t i = 0; i < tris.size(); ++i) {
+            for (int k = 0; k < 3; ++k) boxes[i].expand(vertices[tris[i].v[k]]);
+            ids[i] = (int)i;
+        }
+        bvh.build(boxes, ids, TriBlock::LANES);
+
+        // store triangles in leaf order so each leaf reads one contiguous run
+        std::vector<MeshTri> sorted(tris.size());
+        for (size_t i = 0; i < tris.size(); ++i) sorted[i] = tris[bvh.prims[i]];
+        tris.swap(sorted);
+        std::vector<int> order(tris.size());
+        for (size_t i = 0; i < tris.size(); ++i) order[i] = (int)i;
+        bvh.prims = std::move(order);
+
+        std::vector<TriBlock> newBlocks;
+        std::vector<int> newLeafBlock(bvh.nodes.size(), -1);
+        for (size_t ni = 0; ni < bvh.nodes.size(); ++ni) {
+            const BVHNode& node = bvh.nodes[ni];
+            if (node.count == 0) continue;
+            TriBlock block;
+            for (int k = 0; k < node.count; ++k) {
+                int f = node.first + k;
+                const Vec3& a = vertices[tris[f].v[0]];
+                block.set(k, f, a, vertices[tris[f].v[1]] - a, vertices[tris[f].v[2]] - a);
+            }
+            newLeafBlock[ni] = (int)newBlocks.size();
+            newBlocks.push_back(block);
+        }
+        blocks = std::move(newBlocks);
+        leafBlock = std::move(newLeafBlock);
+    }
+
+    // index ranges of a mesh that was loaded rather than built (see BVH::wellFormed)
+    bool wellFormed() const {
+        if (uvs.size() != vertices.size() || leafBlock.size() != bvh.nodes.size() || !bvh.wellFormed(tris.size()))
+            return false;
+        for (const MeshTri& t : tris) {
+            for (int k = 0; k < 3; ++k) if (t.v[k] < 0 || (size_t)t.v[k] >= vertices.size()) return false;
+            if (t.material < 0 || (size_t)t.material >= materials.size()) return false;
+        }
+        if (bvh.prims.size() != tris.size()) return false;
+        // a leaf's lanes hold exactly its own triangles, in order, and nothing else
+        for (size_t ni = 0; ni < bvh.nodes.size(); ++ni) {
+            const BVHNode& node = bvh.nodes[ni];
+            if (node.count == 0) continue;
+            if (leafBlock[ni] < 0 || (size_t)leafBlock[ni] >= blocks.size()) return false;
+            const TriBlock& b = blocks[leafBlock[ni]];
+            for (int k = 0; k < TriBlock::LANES; ++k)
+                if (k < node.count ? b.face[k] != node.first + k : !b.unused(k)) return false;
+        }
+        return true;
+    }
+
+    std::optional<Hit> intersect(const Ray& ray, Real t_min, Real t_max) const {
+        Hit best{ t_max };
+        bvh.traverseLeaves(ray, t_min, t_max, [&](int ni) {
+            const TriBlock& block = blocks[leafBlock[ni]];
+            Real t, u, v;
+            int lane = block.closest(ray, t_min, t_max, t, u, v);
+            if (lane >= 0) { t_max = t; best = Hit{ t, u, v, PrimKind::Mesh, 0, block.face[lane] }; }
+            return false;
+        });
+        if (best.face < 0) return std::nullopt;
+        return best;
+    }
+
+    // closest hit per active packet lane; best[lane] and t_max[lane] are only
+    // touched when that lane finds something closer
+    void intersect(const RayPacket& p, Real t_min, Real t_max[], unsigned active, Hit best[]) const {
+        bvh.traversePacket(p, t_min, t_max, active, [&](int ni, unsigned mask) {
+            const TriBlock& block = blocks[leafBlock[ni]];
+            for (; mask; mask &= mask - 1) {
+                const int i = __builtin_ctz(mask);
+                Real t, u, v;
+                int lane = block.closest(p.rays[i], t_min, t_max[i], t, u, v);
+                if (lane >= 0) { t_max[i] = t; best[i] = Hit{ t, u, v, PrimKind::Mesh, 0, block.face[lane] }; }
+            }
+        });
+    }
+
+    HitInfo surface(const Ray& ray, const Hit& hit) const {
+        const MeshTri& tri = tris[hit.face];
+        const MeshMaterial& m = materials[tri.material];
+        const Vec3& a = vertices[tri.v[0]];
+
+        HitInfo h;
+        h.t = hit.t;
+        h.point = ray.at(hit.t);
+        h.set_face_normal(ray, (vertices[tri.v[1]] - a).cross(vertices[tri.v[2]] - a).normalized());
+        h.color = m.color;
+        h.tex = m.tex;
+        if (h.tex) {
+            auto [ua, va] = uvs[tri.v[0]];
+            auto [ub, vb] = uvs[tri.v[1]];
+            auto [uc, vc] = uvs[tri.v[2]];
+            interpolateUV(hit.b1, hit.b2, ua, va, ub, vb, uc, vc, h.u, h.v);
+        }
+        return h;
+    }
+
+    bool occluded(const Ray& ray, Real t_max) const {
+        return bvh.traverseLeaves(ray, 0.0, t_max, [&](int ni) {
+            return blocks[leafBlock[ni]].any(ray, t_max);
+        });
+    }
+
+    // lanes of `active` blocked in (0, t_max[lane]); a blocked lane's box range
+    // is set to -inf, which drops it from the rest of the walk
+    unsigned occluded(const RayPacket& p, const Real t_max[], unsigned active) const {
+        Real live[RayPacket::SIZE];
+        std::copy(t_max, t_max + p.count, live);
+        std::fill(live + p.count, live + RayPacket::SIZE, -std::numeric_limits<Real>::infinity());
+        unsigned blocked = 0;
+        bvh.traversePacket(p, 0.0, live, active, [&](int ni, unsigned mask) {
+            for (; mask; mask &= mask - 1) {
+                const int i = __builtin_ctz(mask);
+                if (blocks[leafBlock[ni]].any(p.rays[i], t_max[i])) {
+                    blocked |= 1u << i; live[i] = -std::numeric_limits<Real>::infinity();
+                }
+            }
+        });
+        return blocked;
+    }
+};
+
+#endif // MESH_HPP
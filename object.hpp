@@ -2,21 +2,23 @@
 #define OBJECT_HPP
 
 #include "ray.hpp"
+#include "aabb.hpp"
+#include <cstdint>
 #include <optional>
-#include <memory>
 
 class Texture; // forward declare to avoid include cycle
 
 struct HitInfo {
-    double t;
+    Real t;
     Vec3 point;
     Vec3 normal;
     Vec3 color;
     bool  front_face;
 
     // --- texture payload for triangles/spheres (optional) ---
-    std::shared_ptr<Texture> tex = nullptr;
-    double u = 0.0, v = 0.0;  // valid iff tex != nullptr
+    // non-owning: textures live in Scene::textures for the whole render
+    const Texture* tex = nullptr;
+    Real u = 0.0, v = 0.0;  // valid iff tex != nullptr
 
     void set_face_normal(const Ray& r, const Vec3& outward_normal) {
         front_face = r.direction.dot(outward_normal) < 0;
@@ -24,10 +26,26 @@ struct HitInfo {
     }
 };
 
-class Object {
-public:
-    virtual ~Object() = default;
-    virtual std::optional<HitInfo> intersect(const Ray& ray) const = 0;
+// The primitive set is closed: the scene keeps one contiguous array per kind
+// and dispatches on this tag instead of through a vtable.
+enum class PrimKind : uint8_t { None, Sphere, Plane, Mesh };
+
+// Cheap candidate record from a primitive's intersect(); the full HitInfo is
+// only built (by that primitive's surface()) for the closest one.
+//
+// Every primitive provides the same non-virtual interface:
+//   std::optional<Hit> intersect(const Ray&, Real t_min, Real t_max) const;
+//       nearest hit with t_min < t < t_max; callers shrink t_max as they go
+//   HitInfo surface(const Ray&, const Hit&) const;
+//       point, normal, color and texture payload for a hit from intersect()
+//   bool occluded(const Ray&, Real t_max) const;
+//       shadow query: any hit with 0 < t < t_max, no HitInfo is built
+struct Hit {
+    Real t;
+    Real b1 = 0.0, b2 = 0.0;  // barycentrics of vertex b and c (triangles only)
+    PrimKind kind = PrimKind::None;  // set by the scene
+    int    prim = -1;           // index into the scene array for `kind`
+    int    face = -1;           // triangle within a Mesh
 };
 
 #endif // OBJECT_HPP
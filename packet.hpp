@@ -0,0 +1,75 @@
+// packet.hpp — up to 16 coherent rays (a 4x4 pixel block) traced through a BVH together
+#ifndef PACKET_HPP
+#define PACKET_HPP
+
+#include "aabb.hpp"
+#include "simd.hpp"
+
+struct alignas(32) RayPacket {
+    static constexpr int SIZE = 16;
+
+    // origin and 1/direction split per component for the box test; lanes past
+    // count stay zero and are never in an active mask
+    Real ox[SIZE] = {}, oy[SIZE] = {}, oz[SIZE] = {};
+    Real ix[SIZE] = {}, iy[SIZE] = {}, iz[SIZE] = {};
+    Ray  rays[SIZE];
+    int  count = 0;
+
+    void add(const Ray& r) {
+        int i = count++;
+        rays[i] = r;
+        ox[i] = r.origin.x; oy[i] = r.origin.y; oz[i] = r.origin.z;
+        ix[i] = Real(1) / r.direction.x; iy[i] = Real(1) / r.direction.y; iz[i] = Real(1) / r.direction.z;
+    }
+
+    unsigned all() const { return (1u << count) - 1; }
+
+    // Packets only pay off while the rays agree on the near child everywhere,
+    // i.e. all directions share one octant; otherwise trace the rays one by one.
+    bool coherent() const {
+        for (int i = 1; i < count; ++i)
+            if ((ix[i] < 0) != (ix[0] < 0) || (iy[i] < 0) != (iy[0] < 0) || (iz[i] < 0) != (iz[0] < 0))
+                return false;
+        return count > 1;
+    }
+
+    // lanes of `active` whose ray overlaps box within [t_min, t_max[lane]];
+    // per lane this is exactly AABB::hit(). All SIZE entries of t_max are read,
+    // so callers fill the lanes past count (with -inf, which never hits).
+    unsigned hits(const AABB& box, Real t_min, const Real t_max[SIZE], unsigned active) const {
+#if defined(SIMD4)
+        if (simdAvailable()) return hitsSimd(box, t_min, t_max, active);
+#endif
+        unsigned mask = 0;
+        for (int i = 0; i < count; ++i)
+            if (box.hit(rays[i], Vec3(ix[i], iy[i], iz[i]), t_min, t_max[i])) mask |= 1u << i;
+        return mask & active;
+    }
+
+#if defined(SIMD4)
+    SIMD_TARGET unsigned hitsSimd(const AABB& box, Real t_min, const Real t_max[SIZE], unsigned active) const {
+        unsigned mask = 0;
+        const VReal lox = vset(box.lo.x), loy = vset(box.lo.y), loz = vset(box.lo.z);
+        const VReal hix = vset(box.hi.x), hiy = vset(box.hi.y), hiz = vset(box.hi.z);
+        for (int g = 0; g < SIZE; g += VLANES) {
+            if (!((active >> g) & ((1u << VLANES) - 1))) continue;
+            VReal tn = vset(t_min), tf = vloadu(t_max + g);
+            VReal o = vload(ox + g), inv = vload(ix + g);
+            VReal t0 = vmul(vsub(lox, o), inv), t1 = vmul(vsub(hix, o), inv);
+            tn = vmax(vmin(t1, t0), tn); tf = vmin(vmax(t1, t0), tf);
+            o = vload(oy + g); inv = vload(iy + g);
+            t0 = vmul(vsub(loy, o), inv); t1 = vmul(vsub(hiy, o), inv);
+            tn = vmax(vmin(t1, t0), tn); tf = vmin(vmax(t1, t0), tf);
+            o = vload(oz + g); inv = vload(iz + g);
+            t0 = vmul(vsub(loz, o), inv); t1 = vmul(vsub(hiz, o), inv);
+            tn = vmax(vmin(t1, t0), tn); tf = vmin(vmax(t1, t0), tf);
+            mask |= (unsigned)vmask(vle(tn, tf)) << g;
+        }
+        return mask & active;
+    }
+#endif
+};
+
+static_assert(RayPacket::SIZE % VLANES == 0 && RayPacket::SIZE <= 32, "packet lanes must fill whole registers");
+
+#endif // PACKET_HPP
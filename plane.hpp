@@ -4,24 +4,34 @@
 #include "object.hpp"
 #include <cmath>
 
-class Plane : public Object {
+class Plane {
 public:
     // plane: n·x + D = 0
-    Vec3 n; double D; Vec3 color;
-    Plane(double A, double B, double C, double D, const Vec3& col)
+    Vec3 n; Real D; Vec3 color;
+    Plane(Real A, Real B, Real C, Real D, const Vec3& col)
         : n(Vec3(A,B,C).normalized()), D(D), color(col) {}
 
-    std::optional<HitInfo> intersect(const Ray& ray) const override {
-        double denom = n.dot(ray.direction);
+    std::optional<Hit> intersect(const Ray& ray, Real t_min, Real t_max) const {
+        Real denom = n.dot(ray.direction);
         if (std::fabs(denom) < 1e-8) return std::nullopt; // parallel
-        double t = -(n.dot(ray.origin) + D) / denom;      // n·(o + t d) + D = 0
-        if (t <= 0) return std::nullopt;
+        Real t = -(n.dot(ray.origin) + D) / denom;      // n·(o + t d) + D = 0
+        if (t <= t_min || t >= t_max) return std::nullopt;
+        return Hit{ t };
+    }
 
-        HitInfo h; h.t = t; h.point = ray.at(t);
+    HitInfo surface(const Ray& ray, const Hit& hit) const {
+        HitInfo h; h.t = hit.t; h.point = ray.at(hit.t);
         h.set_face_normal(ray, n);
         h.color = color;
         return h;
     }
+
+    bool occluded(const Ray& ray, Real t_max) const {
+        Real denom = n.dot(ray.direction);
+        if (std::fabs(denom) < 1e-8) return false;
+        Real t = -(n.dot(ray.origin) + D) / denom;
+        return t > 0 && t < t_max;
+    }
 };
 
 #endif
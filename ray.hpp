@@ -12,7 +12,7 @@ public:
     Ray(const Vec3& origin, const Vec3& direction)
         : origin(origin), direction(direction.normalized()) {}
 
-    Vec3 at(double t) const { return origin + direction * t; }
+    Vec3 at(Real t) const { return origin + direction * t; }
 };
 
 #endif // RAY_HPP
\ No newline at end of file
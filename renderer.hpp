@@ -3,111 +3,443 @@
 
 #include "scene.hpp"
 #include "image.hpp"
+#include "scheduler.hpp"
+#include "rng.hpp"
 #include <algorithm>
-#include <random>
+#include <tuple>
 
 class Renderer {
 public:
     const Scene& scene;
-    Renderer(const Scene& s) : scene(s) {}
+    int threads;
+
+    // Single traces every primary ray on its own; Packet traces each 4x4 pixel
+    // block's rays for one sample as a RayPacket; Wavefront runs a whole tile
+    // through one stage at a time. All three give the same image.
+    enum class Mode { Single, Packet, Wavefront };
+    Mode mode = Mode::Packet;
+
+    static constexpr int TILE  = 16;
+    static constexpr int BLOCK = 4;   // BLOCK * BLOCK == RayPacket::SIZE
+
+    Renderer(const Scene& s, int threads = WorkStealingPool::defaultThreads(), Mode mode = Mode::Packet)
+        : scene(s), threads(std::max(1, threads)), mode(mode) {}
 
     void render() {
         Image img(scene.width, scene.height);
         const int W = scene.width, H = scene.height;
-        const int S = std::max(W, H);
 
         // Camera basis — 保持你当前“camera 之前”的版本
         Vec3 f = scene.forward;                        // length -> zoom
-        Vec3 z = f * (1.0 / std::max(1e-12, f.length()));
-        Vec3 r = z.cross(scene.up_hint).normalized();
-        Vec3 u = r.cross(z).normalized();
-
-        std::mt19937 rng(42);
-        std::uniform_real_distribution<double> U(0.0, 1.0);
-        constexpr double EPS = 1e-4;
-
-        for (int y = 0; y < H; ++y) {
-            for (int x = 0; x < W; ++x) {
-                Vec3 accum(0,0,0);
-                unsigned char outA = 0;
-
-                for (int s = 0; s < scene.aa_samples; ++s) {
-                    double jx = (scene.aa_samples==1) ? 0.5 : U(rng);
-                    double jy = (scene.aa_samples==1) ? 0.5 : U(rng);
-
-                    double sx = (2.0 * (x + jx) - W) / (double)S;
-                    double sy = (H - 2.0 * (y + jy)) / (double)S;
-
-                    Vec3 dir = (r * sx) + (u * sy) + z * f.length();
-                    Ray ray(scene.eye, dir);
-
-                    double t_min = 1e30; std::optional<HitInfo> best;
-                    for (const auto& obj : scene.objects) {
-                        auto hit = obj->intersect(ray);
-                        if (hit && hit->t > 0.0 && hit->t < t_min) {
-                            t_min = hit->t; best = hit;
-                        }
-                    }
-                    if (!best) continue;
-
-                    outA = 255;
-
-                    if (scene.suns.empty() && scene.bulbs.empty()) {
-                        continue; // black silhouette with alpha already set
-                    }
-
-                    // === 关键：有纹理则采样，没有则用物体 color ===
-                    Vec3 base = (best->tex)
-                        ? best->tex->sample(best->u, best->v)
-                        : best->color;
-
-                    Vec3 p = best->point;
-                    Vec3 n = best->normal;
-                    Vec3 radiance(0,0,0);
-
-                    // directional suns
-                    for (const auto& sun : scene.suns) {
-                        Vec3 L = (sun.dir).normalized();
-                        Ray sh(p + n*EPS, L);
-                        bool blocked = false;
-                        for (const auto& obj : scene.objects) {
-                            auto shh = obj->intersect(sh);
-                            if (shh && shh->t > 0.0) { blocked = true; break; }
-                        }
-                        if (blocked) continue;
-                        double ndotl = std::max(0.0, n.dot(L));
-                        radiance += Vec3(base.x*sun.color.x, base.y*sun.color.y, base.z*sun.color.z) * ndotl;
-                    }
-
-                    // point bulbs
-                    for (const auto& b : scene.bulbs) {
-                        Vec3 toL = b.pos - p;
-                        double dist = toL.length();
-                        if (dist < 1e-12) continue;
-                        Vec3 L = toL / dist;
-                        Ray sh(p + n*EPS, L);
-                        bool blocked = false;
-                        for (const auto& obj : scene.objects) {
-                            auto shh = obj->intersect(sh);
-                            if (shh && shh->t > 0.0 && shh->t < dist - EPS) { blocked = true; break; }
-                        }
-                        if (blocked) continue;
-                        double ndotl = std::max(0.0, n.dot(L));
-                        double att = 1.0 / std::max(1e-6, dist*dist);
-                        radiance += Vec3(base.x*b.color.x, base.y*b.color.y, base.z*b.color.z) * (ndotl * att);
-                    }
-
-                    accum += radiance;
-                }
+        z = f * (1.0 / std::max<double>(1e-12, f.length()));
+        r = z.cross(scene.up_hint).normalized();
+        u = r.cross(z).normalized();
+        zoom = f.length();
+
+        const int tilesX = (W + TILE - 1) / TILE, tilesY = (H + TILE - 1) / TILE;
+        WorkStealingPool pool(threads);
+        std::vector<Wavefront> streams(mode == Mode::Wavefront ? pool.size() : 0);
+        pool.run(tilesX * tilesY, [&](int tile, int worker) {
+            int x0 = (tile % tilesX) * TILE, y0 = (tile / tilesX) * TILE;
+            int x1 = std::min(x0 + TILE, W), y1 = std::min(y0 + TILE, H);
+            if (mode == Mode::Wavefront) {
+                renderTile(img, streams[worker], x0, y0, x1, y1);
+                return;
+            }
+            if (mode == Mode::Packet) {
+                for (int by = y0; by < y1; by += BLOCK)
+                    for (int bx = x0; bx < x1; bx += BLOCK)
+                        renderBlock(img, bx, by, std::min(bx + BLOCK, x1), std::min(by + BLOCK, y1));
+                return;
+            }
+            for (int y = y0; y < y1; ++y)
+                for (int x = x0; x < x1; ++x)
+                    renderPixel(img, x, y);
+        });
+
+        img.save(scene.filename);
+    }
+
+private:
+    Vec3 r, u, z;
+    Real zoom = 1;
+
+    // Running sum of one pixel's samples. Misses count as black samples for the
+    // variance estimate but leave the color sum alone.
+    struct PixelSum {
+        Vec3 accum;
+        bool covered = false;
+        int n = 0;
+        double lum = 0, lum2 = 0;  // sum and sum of squares of sample luminance
+
+        void add(const Vec3& radiance, bool hit) {
+            ++n;
+            if (!hit) return;
+            covered = true;
+            accum += radiance;
+            double l = 0.2126 * radiance.x + 0.7152 * radiance.y + 0.0722 * radiance.z;
+            lum += l; lum2 += l * l;
+        }
+    };
+
+    // One worker's SoA buffers for the wavefront path, reused from tile to tile.
+    struct Wavefront {
+        // pixels of the tile in 4x4 block order, with their running sums
+        std::vector<int> px, py;
+        std::vector<PixelSum> sums;
+        // camera ray stream, one ray per pixel still sampling
+        std::vector<int> active;  // ray -> pixel
+        std::vector<Ray> rays;
+        std::vector<std::optional<HitInfo>> hits;
+        // compacted hits
+        std::vector<int> pixel;   // hit -> ray
+        std::vector<Vec3> point, normal, base, origin, radiance;
+        // shadow ray stream for one light
+        std::vector<Ray> shadow;
+        std::vector<Real> t_max, dist;
+        std::vector<int> owner;  // shadow ray -> compacted hit
+        std::vector<unsigned char> blocked;
+    };
+
+    // origin offset for shadow rays; in float it grows with |p| so it stays
+    // well above the rounding error of the hit point
+    static Real rayEps(const Vec3& p) {
+        if constexpr (sizeof(Real) == sizeof(double)) return 1e-4;
+        else return Real(1e-4) * std::max({ Real(1), std::fabs(p.x), std::fabs(p.y), std::fabs(p.z) });
+    }
+
+    // AA jitter is hashed from (x, y, sample), so the result does not depend
+    // on tile order or thread count.
+    Ray primaryRay(const PixelRNG& rng, int x, int y, int s) const {
+        const int W = scene.width, H = scene.height;
+        const int S = std::max(W, H);
+
+        double jx = 0.5, jy = 0.5;
+        if (scene.aa_samples > 1) std::tie(jx, jy) = rng.jitter(scene.sampler, s, scene.aa_samples);
 
-                if (scene.aa_samples > 1) accum /= (double)scene.aa_samples;
+        double sx = (2.0 * (x + jx) - W) / (double)S;
+        double sy = (H - 2.0 * (y + jy)) / (double)S;
 
-                if (outA == 0) img.setRGBA(x,y,0,0,0,0);
-                else           img.setLinear(x,y,accum.x,accum.y,accum.z,255);
+        Vec3 dir = (r * sx) + (u * sy) + z * zoom;
+        return Ray(scene.eye, dir);
+    }
+
+    // === 关键：有纹理则采样，没有则用物体 color ===
+    static Vec3 albedo(const HitInfo& hit) {
+        return (hit.tex)
+            ? hit.tex->sample(hit.u, hit.v)
+            : hit.color;
+    }
+
+    // direct light reflected toward the camera at a primary hit
+    Vec3 shade(const HitInfo& hit) const {
+        if (scene.suns.empty() && scene.bulbs.empty()) {
+            return Vec3(0,0,0); // black silhouette with alpha already set
+        }
+        return direct(hit, albedo(hit));
+    }
+
+    // light from suns and bulbs reaching a diffuse surface of color `base`
+    Vec3 direct(const HitInfo& hit, const Vec3& base) const {
+        Vec3 radiance(0,0,0);
+        Vec3 p = hit.point;
+        Vec3 n = hit.normal;
+        const Real EPS = rayEps(p);
+
+        // directional suns
+        for (const auto& sun : scene.suns) {
+            Vec3 L = (sun.dir).normalized();
+            Ray sh(p + n*EPS, L);
+            if (scene.occluded(sh, std::numeric_limits<Real>::infinity())) continue;
+            Real ndotl = std::max<Real>(0, n.dot(L));
+            radiance += Vec3(base.x*sun.color.x, base.y*sun.color.y, base.z*sun.color.z) * ndotl;
+        }
+
+        // point bulbs
+        for (const auto& b : scene.bulbs) {
+            Vec3 toL = b.pos - p;
+            Real dist = toL.length();
+            if (dist < 1e-12) continue;
+            Vec3 L = toL / dist;
+            Ray sh(p + n*EPS, L);
+            if (scene.occluded(sh, dist - EPS)) continue;
+            Real ndotl = std::max<Real>(0, n.dot(L));
+            Real att = Real(1) / std::max<Real>(1e-6, dist*dist);
+            radiance += Vec3(base.x*b.color.x, base.y*b.color.y, base.z*b.color.z) * (ndotl * att);
+        }
+        return radiance;
+    }
+
+    static constexpr int RR_DEPTH = 2;  // bounces before Russian roulette starts
+
+    // Diffuse interreflection: up to scene.bounces further hits after the primary
+    // one, each adding its direct light weighted by the path throughput. Bounce
+    // directions are cosine-distributed, so the throughput just picks up each
+    // surface's albedo. Paths end early once the throughput is negligible, and
+    // after RR_DEPTH bounces survive with probability = max throughput channel.
+    // Random numbers come from the pixel's RNG, dimension 1 + 2*depth (+1).
+    Vec3 indirect(const HitInfo& hit, const PixelRNG& rng, int s) const {
+        Vec3 radiance(0,0,0);
+        if (scene.bounces == 0 || (scene.suns.empty() && scene.bulbs.empty())) return radiance;
+
+        Vec3 throughput = albedo(hit);
+        HitInfo cur = hit;
+        for (int depth = 0; depth < scene.bounces; ++depth) {
+            Real q = std::max({ throughput.x, throughput.y, throughput.z });
+            if (q < Real(1e-4)) break;
+            if (depth >= RR_DEPTH) {
+                q = std::min<Real>(q, 0.95);
+                if (rng.uniform(s, 2 + 2 * depth) >= q) break;
+                throughput /= q;
             }
+
+            double u1, u2;
+            std::tie(u1, u2) = rng.uniform2(s, 1 + 2 * depth);
+            Ray ray(cur.point + cur.normal * rayEps(cur.point), cosineDirection(cur.normal, u1, u2));
+            std::optional<HitInfo> next = scene.intersect(ray);
+            if (!next) break;
+
+            Vec3 base = albedo(*next);
+            Vec3 d = direct(*next, base);
+            radiance += Vec3(throughput.x*d.x, throughput.y*d.y, throughput.z*d.z);
+            throughput = Vec3(throughput.x*base.x, throughput.y*base.y, throughput.z*base.z);
+            cur = *next;
         }
+        return radiance;
+    }
 
-        img.save(scene.filename);
+    // cosine-weighted direction on the hemisphere around unit normal n
+    static Vec3 cosineDirection(const Vec3& n, double u1, double u2) {
+        Vec3 t = (std::fabs(n.x) > 0.9 ? Vec3(0,1,0) : Vec3(1,0,0)).cross(n).normalized();
+        Vec3 b = n.cross(t);
+        double r = std::sqrt(u1), phi = 2.0 * M_PI * u2;
+        return t * (r * std::cos(phi)) + b * (r * std::sin(phi)) + n * std::sqrt(std::max(0.0, 1.0 - u1));
+    }
+
+    // true while the pixel needs another sample: below the aa ceiling and, with
+    // adaptive sampling, either under the base count or not converged yet, i.e.
+    // the standard error of its mean luminance is above threshold * mean
+    bool wantsSample(const PixelSum& p) const {
+        if (p.n >= scene.aa_samples) return false;
+        if (scene.adaptive_threshold <= 0 || p.n < scene.adaptive_base) return true;
+        double mean = p.lum / p.n;
+        double var  = std::max(0.0, (p.lum2 - p.lum * mean) / (p.n - 1));
+        double tol  = scene.adaptive_threshold * std::max(mean, 1e-2);
+        return var > tol * tol * p.n;
+    }
+
+    void writePixel(Image& img, int x, int y, const PixelSum& p) const {
+        Vec3 accum = p.accum;
+        if (p.n > 1) accum /= (Real)p.n;
+
+        if (!p.covered) img.setRGBA(x,y,0,0,0,0);
+        else            img.setLinear(x,y,accum.x,accum.y,accum.z,255);
+    }
+
+    void renderPixel(Image& img, int x, int y) const {
+        const PixelRNG rng(x, y);
+
+        PixelSum sum;
+        for (int s = 0; wantsSample(sum); ++s) {
+            std::optional<HitInfo> best = scene.intersect(primaryRay(rng, x, y, s));
+            if (!best) { sum.add(Vec3(0,0,0), false); continue; }
+            Vec3 radiance = shade(*best);
+            radiance += indirect(*best, rng, s);
+            sum.add(radiance, true);
+        }
+        writePixel(img, x, y, sum);
+    }
+
+    // Shadow stage for one packet of primary hits. Instead of testing every
+    // light per hit, each light gathers the shadow rays of all hits and traces
+    // them as one packet: sun rays share a direction, bulb rays an endpoint.
+    // Per pixel the sums run in the same order as shade(), so the result matches.
+    void shadePacket(const std::optional<HitInfo> hits[], int n, Vec3 radiance[]) const {
+        for (int i = 0; i < n; ++i) radiance[i] = Vec3(0,0,0);
+        if (scene.suns.empty() && scene.bulbs.empty()) return;
+
+        Vec3 base[RayPacket::SIZE], origin[RayPacket::SIZE];
+        for (int i = 0; i < n; ++i) {
+            if (!hits[i]) continue;
+            const HitInfo& h = *hits[i];
+            base[i]   = albedo(h);
+            origin[i] = h.point + h.normal * rayEps(h.point);
+        }
+
+        int pixel[RayPacket::SIZE];   // packet lane -> index into hits
+        Real t_max[RayPacket::SIZE];
+        std::fill(t_max, t_max + RayPacket::SIZE, -std::numeric_limits<Real>::infinity());
+        for (const auto& sun : scene.suns) {
+            Vec3 L = (sun.dir).normalized();
+            RayPacket sh;
+            for (int i = 0; i < n; ++i) {
+                if (!hits[i]) continue;
+                pixel[sh.count] = i; t_max[sh.count] = std::numeric_limits<Real>::infinity();
+                sh.add(Ray(origin[i], L));
+            }
+            const unsigned blocked = scene.occluded(sh, t_max);
+            for (int k = 0; k < sh.count; ++k) {
+                if (blocked >> k & 1) continue;
+                const int i = pixel[k];
+                Real ndotl = std::max<Real>(0, hits[i]->normal.dot(L));
+                radiance[i] += Vec3(base[i].x*sun.color.x, base[i].y*sun.color.y, base[i].z*sun.color.z) * ndotl;
+            }
+        }
+
+        Vec3 dir[RayPacket::SIZE];
+        Real len[RayPacket::SIZE];
+        for (const auto& b : scene.bulbs) {
+            RayPacket sh;
+            for (int i = 0; i < n; ++i) {
+                if (!hits[i]) continue;
+                const Vec3& p = hits[i]->point;
+                Vec3 toL = b.pos - p;
+                Real dist = toL.length();
+                if (dist < 1e-12) continue;
+                Vec3 L = toL / dist;
+                pixel[sh.count] = i; t_max[sh.count] = dist - rayEps(p); dir[sh.count] = L; len[sh.count] = dist;
+                sh.add(Ray(origin[i], L));
+            }
+            const unsigned blocked = scene.occluded(sh, t_max);
+            for (int k = 0; k < sh.count; ++k) {
+                if (blocked >> k & 1) continue;
+                const int i = pixel[k];
+                const Vec3& L = dir[k];
+                Real dist = len[k];
+                Real ndotl = std::max<Real>(0, hits[i]->normal.dot(L));
+                Real att = Real(1) / std::max<Real>(1e-6, dist*dist);
+                radiance[i] += Vec3(base[i].x*b.color.x, base[i].y*b.color.y, base[i].z*b.color.z) * (ndotl * att);
+            }
+        }
+    }
+
+    // pixels [x0, x1) x [y0, y1), at most BLOCK x BLOCK: sample s of every pixel
+    // that still wants one goes out as one packet, and so do its shadow rays,
+    // one packet per light
+    void renderBlock(Image& img, int x0, int y0, int x1, int y1) const {
+        const int bw = x1 - x0, n = bw * (y1 - y0);
+        PixelSum sum[RayPacket::SIZE];
+
+        std::optional<HitInfo> hits[RayPacket::SIZE];
+        Vec3 radiance[RayPacket::SIZE];
+        int pixel[RayPacket::SIZE];   // packet lane -> pixel of the block
+        for (int s = 0; ; ++s) {
+            RayPacket packet;
+            for (int i = 0; i < n; ++i) {
+                if (!wantsSample(sum[i])) continue;
+                const int x = x0 + i % bw, y = y0 + i / bw;
+                pixel[packet.count] = i;
+                packet.add(primaryRay(PixelRNG(x, y), x, y, s));
+            }
+            if (packet.count == 0) break;
+            scene.intersect(packet, hits);
+            shadePacket(hits, packet.count, radiance);
+            for (int k = 0; k < packet.count; ++k) {
+                const int i = pixel[k];
+                // bounce rays scatter, so they are traced one at a time
+                if (hits[k] && scene.bounces > 0)
+                    radiance[k] += indirect(*hits[k], PixelRNG(x0 + i % bw, y0 + i / bw), s);
+                sum[i].add(radiance[k], hits[k].has_value());
+            }
+        }
+        for (int i = 0; i < n; ++i) writePixel(img, x0 + i % bw, y0 + i / bw, sum[i]);
+    }
+
+    // Wavefront path for the tile [x0, x1) x [y0, y1). Per sample each stage is
+    // one loop over the whole tile: camera rays, closest hits, compaction,
+    // surface setup, then per light a shadow stream and its resolve. Every sum
+    // runs in the same per-pixel order as shade(), so the image is unchanged.
+    void renderTile(Image& img, Wavefront& w, int x0, int y0, int x1, int y1) const {
+        w.px.clear(); w.py.clear();
+        for (int by = y0; by < y1; by += BLOCK)
+            for (int bx = x0; bx < x1; bx += BLOCK)
+                for (int y = by; y < std::min(by + BLOCK, y1); ++y)
+                    for (int x = bx; x < std::min(bx + BLOCK, x1); ++x) { w.px.push_back(x); w.py.push_back(y); }
+        const int n = (int)w.px.size();
+        w.sums.assign(n, PixelSum());
+
+        for (int s = 0; ; ++s) {
+            // camera rays for the pixels that still want a sample
+            w.active.clear();
+            for (int i = 0; i < n; ++i) if (wantsSample(w.sums[i])) w.active.push_back(i);
+            const int c = (int)w.active.size();
+            if (c == 0) break;
+            w.rays.resize(c); w.hits.resize(c);
+            for (int k = 0; k < c; ++k) {
+                const int i = w.active[k];
+                w.rays[k] = primaryRay(PixelRNG(w.px[i], w.py[i]), w.px[i], w.py[i], s);
+            }
+
+            // closest hits
+            scene.intersect(w.rays.data(), c, w.hits.data());
+
+            // compaction
+            w.pixel.clear();
+            for (int k = 0; k < c; ++k) if (w.hits[k]) w.pixel.push_back(k);
+            const int m = (int)w.pixel.size();
+            w.radiance.assign(m, Vec3(0,0,0));
+
+            // surface setup (none needed when there are no lights)
+            w.point.resize(m); w.normal.resize(m); w.base.resize(m); w.origin.resize(m);
+            for (int j = 0; j < m && (!scene.suns.empty() || !scene.bulbs.empty()); ++j) {
+                const HitInfo& h = *w.hits[w.pixel[j]];
+                w.point[j]  = h.point;
+                w.normal[j] = h.normal;
+                w.base[j]   = albedo(h);
+                w.origin[j] = h.point + h.normal * rayEps(h.point);
+            }
+
+            // shadow streams, one light at a time
+            for (const auto& sun : scene.suns) {
+                Vec3 L = (sun.dir).normalized();
+                w.shadow.resize(m); w.t_max.assign(m, std::numeric_limits<Real>::infinity()); w.blocked.resize(m);
+                for (int j = 0; j < m; ++j) w.shadow[j] = Ray(w.origin[j], L);
+                scene.occluded(w.shadow.data(), w.t_max.data(), m, w.blocked.data());
+                for (int j = 0; j < m; ++j) {
+                    if (w.blocked[j]) continue;
+                    Real ndotl = std::max<Real>(0, w.normal[j].dot(L));
+                    w.radiance[j] += Vec3(w.base[j].x*sun.color.x, w.base[j].y*sun.color.y, w.base[j].z*sun.color.z) * ndotl;
+                }
+            }
+            for (const auto& b : scene.bulbs) {
+                w.shadow.clear(); w.t_max.clear(); w.dist.clear(); w.owner.clear();
+                for (int j = 0; j < m; ++j) {
+                    Vec3 toL = b.pos - w.point[j];
+                    Real dist = toL.length();
+                    if (dist < 1e-12) continue;
+                    w.shadow.emplace_back(w.origin[j], toL / dist);
+                    w.t_max.push_back(dist - rayEps(w.point[j]));
+                    w.dist.push_back(dist);
+                    w.owner.push_back(j);
+                }
+                const int k = (int)w.shadow.size();
+                w.blocked.resize(k);
+                scene.occluded(w.shadow.data(), w.t_max.data(), k, w.blocked.data());
+                for (int q = 0; q < k; ++q) {
+                    if (w.blocked[q]) continue;
+                    const int j = w.owner[q];
+                    const Vec3 L = (b.pos - w.point[j]) / w.dist[q];
+                    Real ndotl = std::max<Real>(0, w.normal[j].dot(L));
+                    Real att = Real(1) / std::max<Real>(1e-6, w.dist[q]*w.dist[q]);
+                    w.radiance[j] += Vec3(w.base[j].x*b.color.x, w.base[j].y*b.color.y, w.base[j].z*b.color.z) * (ndotl * att);
+                }
+            }
+
+            // indirect bounces, traced one path at a time
+            if (scene.bounces > 0)
+                for (int j = 0; j < m; ++j) {
+                    const int i = w.active[w.pixel[j]];
+                    w.radiance[j] += indirect(*w.hits[w.pixel[j]], PixelRNG(w.px[i], w.py[i]), s);
+                }
+
+            // resolve, in ray order so every pixel takes its sample
+            for (int k = 0, j = 0; k < c; ++k) {
+                const bool hit = j < (int)w.pixel.size() && w.pixel[j] == k;
+                w.sums[w.active[k]].add(hit ? w.radiance[j] : Vec3(0,0,0), hit);
+                if (hit) ++j;
+            }
+        }
+        for (int i = 0; i < n; ++i) writePixel(img, w.px[i], w.py[i], w.sums[i]);
     }
 };
 
@@ -0,0 +1,119 @@
+// rng.hpp — stateless counter-based random numbers for per-pixel sampling
+#ifndef RNG_HPP
+#define RNG_HPP
+
+#include <cstdint>
+#include <utility>
+
+// pcg4d (Jarzynski & Olano, "Hash Functions for GPU Rendering", 2020):
+// four 32-bit counters in, four well-mixed 32-bit words out, no state.
+inline void pcg4d(uint32_t& x, uint32_t& y, uint32_t& z, uint32_t& w) {
+    x = x * 1664525u + 1013904223u;
+    y = y * 1664525u + 1013904223u;
+    z = z * 1664525u + 1013904223u;
+    w = w * 1664525u + 1013904223u;
+    x += y*w; y += z*x; z += x*y; w += y*z;
+    x ^= x >> 16; y ^= y >> 16; z ^= z >> 16; w ^= w >> 16;
+    x += y*w; y += z*x; z += x*y; w += y*z;
+}
+
+// Sample patterns for the AA jitter, picked with the scene command `sampler`.
+enum class Sampler { Random, Stratified, Sobol };
+
+inline uint32_t reverseBits(uint32_t x) {
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+    x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+    x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+    x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+    return x;
+}
+
+// element i of a pseudo-random permutation of [0, l) chosen by p
+// (Kensler, "Correlated Multi-Jittered Sampling", 2013)
+inline uint32_t permute(uint32_t i, uint32_t l, uint32_t p) {
+    uint32_t w = l - 1;
+    w |= w >> 1; w |= w >> 2; w |= w >> 4; w |= w >> 8; w |= w >> 16;
+    do {
+        i ^= p; i *= 0xe170893du;
+        i ^= p >> 16;
+        i ^= (i & w) >> 4;
+        i ^= p >> 8; i *= 0x0929eb3fu;
+        i ^= p >> 23;
+        i ^= (i & w) >> 1; i *= 1 | p >> 27;
+        i *= 0x6935fa69u;
+        i ^= (i & w) >> 11; i *= 0x74dcb303u;
+        i ^= (i & w) >> 2; i *= 0x9e501cc3u;
+        i ^= (i & w) >> 2; i *= 0xc860a3dfu;
+        i &= w;
+        i ^= i >> 5;
+    } while (i >= l);
+    return (i + p) % l;
+}
+
+// hash-based Owen scrambling (Burley, "Practical Hash-based Owen Scrambling", 2020)
+inline uint32_t owenScramble(uint32_t x, uint32_t seed) {
+    x = reverseBits(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return reverseBits(x);
+}
+
+// second Sobol dimension; the first is reverseBits(i)
+inline uint32_t sobol1(uint32_t i) {
+    uint32_t r = 0;
+    for (uint32_t v = 1u << 31; i; i >>= 1, v ^= v >> 1)
+        if (i & 1) r ^= v;
+    return r;
+}
+
+// Every value is a pure function of (pixel, sample, dimension, seed), so pixels
+// and samples can be evaluated in any order on any thread with the same result.
+class PixelRNG {
+public:
+    PixelRNG(int px, int py, uint32_t seed = 42)
+        : px((uint32_t)px), py((uint32_t)py), seed(seed) {}
+
+    // two independent uniforms in [0,1) for sample `s`, dimension pair `dim`
+    std::pair<double,double> uniform2(int s, uint32_t dim = 0) const {
+        uint32_t x = px, y = py, z = (uint32_t)s, w = seed ^ (dim * 0x9E3779B9u);
+        pcg4d(x, y, z, w);
+        return { toUnit(x), toUnit(y) };
+    }
+
+    double uniform(int s, uint32_t dim = 0) const { return uniform2(s, dim).first; }
+
+    // AA jitter in [0,1)^2 for sample s of at most `count`:
+    //   Random      independent uniforms, as uniform2(s)
+    //   Stratified  one jittered cell of a sqrt(count)^2 grid per sample, cells
+    //               in a per-pixel shuffled order; samples past the grid are Random
+    //   Sobol       Owen-scrambled (0,2)-sequence: every power-of-two prefix is
+    //               stratified, which suits adaptive sampling's early stops
+    std::pair<double,double> jitter(Sampler kind, int s, int count) const {
+        if (kind == Sampler::Random) return uniform2(s);
+
+        uint32_t x = px, y = py, z = ~0u, w = seed;   // per-pixel scramble words
+        pcg4d(x, y, z, w);
+        if (kind == Sampler::Sobol) {
+            uint32_t i = owenScramble((uint32_t)s, x);
+            return { toUnit(owenScramble(reverseBits(i), y)), toUnit(owenScramble(sobol1(i), z)) };
+        }
+
+        int m = 1;
+        while ((m + 1) * (m + 1) <= count) ++m;
+        if (s >= m * m) return uniform2(s);
+        uint32_t cell = permute((uint32_t)s, (uint32_t)(m * m), x);
+        auto [jx, jy] = uniform2(s);
+        return { (cell % m + jx) / m, (cell / m + jy) / m };
+    }
+
+private:
+    uint32_t px, py, seed;
+
+    static double toUnit(uint32_t v) { return v * (1.0 / 4294967296.0); }
+};
+
+#endif // RNG_HPP
@@ -2,17 +2,27 @@
 #define SCENE_HPP
 
 #include <fstream>
-#include <sstream>
+#include <cstring>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <unordered_map>
 #include <algorithm>
+#include <limits>
 
 #include "sphere.hpp"
 #include "plane.hpp"
 #include "triangle.hpp"
+#include "mesh.hpp"
 #include "texture.hpp"
+#include "bvh.hpp"
+#include "rng.hpp"
+#include "tokenizer.hpp"
+#include "mapped_file.hpp"
+#include "scene_chunk.hpp"
+#include "scene_cache.hpp"
+#include "scheduler.hpp"
 
 struct Sun  { Vec3 dir; Vec3 color; };
 struct Bulb { Vec3 pos; Vec3 color; };
@@ -29,104 +39,491 @@ public:
 
     int bounces    = 0;
     int aa_samples = 1;
+    // adaptive AA (off at 0): after adaptive_base samples a pixel stops once its
+    // mean has converged to within this relative error; aa_samples is the ceiling
+    double adaptive_threshold = 0;
+    int    adaptive_base      = 8;
+    Sampler sampler = Sampler::Random;  // AA jitter pattern
 
     Vec3 current_color = Vec3(1,1,1);
 
     // --- texture state/cache ---
-    std::shared_ptr<Texture> current_tex = nullptr; // "texture none" by default
-    std::unordered_map<std::string, std::shared_ptr<Texture>> tex_cache;
+    // the scene owns every texture; primitives and hits only hold raw pointers
+    std::vector<std::unique_ptr<Texture>> textures;
+    const Texture* current_tex = nullptr; // "texture none" by default
+    std::unordered_map<std::string, const Texture*> tex_cache;
 
-    // xyz pool + per-xyz uv captured by texcoord
-    std::vector<Vec3> xyz_vertices;
-    std::vector<std::pair<double,double>> xyz_uvs;
     double cur_u = 0.0, cur_v = 0.0; // default texcoord
 
-    // scene content
-    std::vector<std::shared_ptr<Object>> objects;
+    // scene content, one contiguous array per primitive kind (see PrimKind)
+    std::vector<Sphere> spheres;
+    std::vector<Plane>  planes;   // unbounded, scanned linearly
+    Mesh mesh;                    // every tri; its xyz pool keeps the uv captured by texcoord
     std::vector<Sun>  suns;
     std::vector<Bulb> bulbs;
 
-    std::shared_ptr<Texture> getTexture(const std::string& path) {
+    // acceleration: spheres get their own BVH, the mesh carries one internally
+    BVH sphere_bvh;
+    // a loaded cache stays mapped: both BVHs and the mesh blocks point into it
+    MappedFile cache_map;
+
+    // cache records: texture pointers become indices into `textures` (-1: none)
+    struct SphereRecord   { Vec3 center; Real radius; Vec3 color; int32_t tex; };
+    struct PlaneRecord    { Vec3 n; Real D; Vec3 color; };
+    struct MaterialRecord { Vec3 color; int32_t tex; };
+
+    // failed loads are remembered too (as nullptr), so every texture file the
+    // scene refers to is listed in tex_cache
+    const Texture* getTexture(const std::string& path) {
         auto it = tex_cache.find(path);
         if (it != tex_cache.end()) return it->second;
-        auto t = std::make_shared<Texture>();
-        if (!t->load(path)) return nullptr;
-        tex_cache[path] = t;
-        return t;
+        auto t = std::make_unique<Texture>();
+        if (!t->load(path)) { tex_cache[path] = nullptr; return nullptr; }
+        textures.push_back(std::move(t));
+        tex_cache[path] = textures.back().get();
+        return textures.back().get();
+    }
+
+    // Uses the compiled cache next to the file when it is up to date (see
+    // saveCache), and parses the text otherwise.
+    bool loadFromFile(const std::string& path, int threads = 1) {
+        return loadCache(path) || loadText(path, threads);
+    }
+
+    // Parses the file in place from a memory map when it can, otherwise reads it
+    // in large blocks; either way no line is copied.
+    // Large mapped files are split across `threads` (see parseParallel).
+    bool loadText(const std::string& path, int threads = 1) {
+        MappedFile map;
+        if (map.open(path)) {
+            if (threads > 1 && map.size() >= PARALLEL_MIN_BYTES) parseParallel(map.data(), map.data() + map.size(), threads);
+            else parse(map.data(), map.data() + map.size());
+        }
+        else if (!readFile(path)) return false;
+        buildAccel();
+        return true;
+    }
+
+    // --- compiled scene cache: <scene file>.rtc ---
+    // Holds everything loadText() produces, decoded textures and built BVHs
+    // included, as flat arrays. It records the size and mtime of the scene file
+    // and of every texture it names; loadCache() refuses it if any changed, if
+    // it was written by another version, or by a build with other struct layouts,
+    // and also if it is short or any index in it is out of range.
+    // The acceleration structures are not copied out: they are index based, so
+    // traversal runs on the mapped pages directly, and processes rendering the
+    // same cache share one copy of them in the page cache.
+    static std::string cachePath(const std::string& path) { return path + ".rtc"; }
+
+    static constexpr uint32_t cacheLayout() {
+        return (uint32_t)(sizeof(Real) | sizeof(Vec3) << 4 | sizeof(BVHNode) << 10 | sizeof(MeshTri) << 17 |
+                          sizeof(TriBlock) << 22 | BVH::MAX_LEAF << 28);
+    }
+
+    bool saveCache(const std::string& path) const {
+        CacheWriter out(cachePath(path));
+        if (!out) return false;
+        CacheHeader header;
+        header.layout = cacheLayout();
+        out.pod(header);
+
+        // texture names resolve against the working directory, as when parsing
+        out.pod(FileStamp::of(path));
+        out.pod((uint64_t)tex_cache.size());
+        for (const auto& [file, tex] : tex_cache) { out.string(file); out.pod(FileStamp::of(file)); }
+
+        out.pod(width); out.pod(height); out.string(filename);
+        out.pod(eye); out.pod(forward); out.pod(up_hint);
+        out.pod(bounces); out.pod(aa_samples);
+        out.pod(adaptive_threshold); out.pod(adaptive_base); out.pod(sampler);
+
+        auto texIndex = [&](const Texture* t) {
+            for (size_t i = 0; i < textures.size(); ++i) if (textures[i].get() == t) return (int32_t)i;
+            return (int32_t)-1;
+        };
+        out.pod((uint64_t)textures.size());
+        for (const auto& t : textures) { out.pod(t->w); out.pod(t->h); out.array(t->data); }
+
+        std::vector<SphereRecord> sr;
+        for (const Sphere& sp : spheres) sr.push_back(SphereRecord{ sp.center, sp.radius, sp.color, texIndex(sp.tex) });
+        std::vector<PlaneRecord> pr;
+        for (const Plane& pl : planes) pr.push_back(PlaneRecord{ pl.n, pl.D, pl.color });
+        std::vector<MaterialRecord> mr;
+        for (const MeshMaterial& m : mesh.materials) mr.push_back(MaterialRecord{ m.color, texIndex(m.tex) });
+        out.array(sr); out.array(pr); out.array(suns); out.array(bulbs);
+        out.array(mesh.vertices); out.array(mesh.uvs); out.array(mesh.tris); out.array(mr);
+        out.array(mesh.bvh.nodes); out.array(mesh.bvh.prims); out.array(mesh.blocks); out.array(mesh.leafBlock);
+        out.array(sphere_bvh.nodes); out.array(sphere_bvh.prims);
+        return out.close();
+    }
+
+    bool loadCache(const std::string& path) {
+        MappedFile map;
+        if (!map.open(cachePath(path), false)) return false;
+        CacheReader in(map.data(), map.size());
+
+        CacheHeader header;
+        in.pod(header);
+        if (!in || !header.valid(cacheLayout())) return false;
+        FileStamp self; uint64_t nsrc = 0;
+        in.pod(self).pod(nsrc);
+        if (!in || !(FileStamp::of(path) == self)) return false;
+        for (uint64_t i = 0; in && i < nsrc; ++i) {
+            std::string file; FileStamp stamp;
+            in.string(file).pod(stamp);
+            if (!in || !(FileStamp::of(file) == stamp)) return false;   // stale
+        }
+
+        in.pod(width).pod(height).string(filename);
+        in.pod(eye).pod(forward).pod(up_hint);
+        in.pod(bounces).pod(aa_samples);
+        in.pod(adaptive_threshold).pod(adaptive_base).pod(sampler);
+
+        uint64_t ntex = 0;
+        in.pod(ntex);
+        for (uint64_t i = 0; in && i < ntex; ++i) {
+            auto t = std::make_unique<Texture>();
+            t->comp = 4;
+            in.pod(t->w).pod(t->h).array(t->data);
+            if (t->w <= 0 || t->h <= 0 || t->data.size() != (uint64_t)t->w * t->h * 4) { *this = Scene(); return false; }
+            textures.push_back(std::move(t));
+        }
+        bool refsOk = true;   // every texture index is -1 or names a loaded texture
+        auto texture = [&](int32_t i) -> const Texture* {
+            if (i < -1 || i >= (int32_t)textures.size()) refsOk = false;
+            return i >= 0 && refsOk ? textures[i].get() : nullptr;
+        };
+
+        std::vector<SphereRecord> sr; std::vector<PlaneRecord> pr; std::vector<MaterialRecord> mr;
+        in.array(sr).array(pr).array(suns).array(bulbs);
+        in.array(mesh.vertices).array(mesh.uvs).array(mesh.tris).array(mr);
+        in.map(mesh.bvh.nodes).map(mesh.bvh.prims).map(mesh.blocks).map(mesh.leafBlock);
+        in.map(sphere_bvh.nodes).map(sphere_bvh.prims);
+        if (!in) { *this = Scene(); return false; }
+
+        for (const SphereRecord& r : sr) spheres.emplace_back(r.center, r.radius, r.color, texture(r.tex));
+        for (const PlaneRecord& r : pr) {
+            planes.emplace_back(0, 0, 1, 0, r.color);
+            planes.back().n = r.n; planes.back().D = r.D;
+        }
+        for (const MaterialRecord& r : mr) mesh.materials.push_back(MeshMaterial{ r.color, texture(r.tex) });
+
+        // the stamps only catch edits: a damaged file must not hand out bad indices
+        if (!refsOk || width < 0 || height < 0 || !mesh.wellFormed() || !sphere_bvh.wellFormed(spheres.size())) {
+            *this = Scene();
+            return false;
+        }
+        cache_map = std::move(map);
+        return true;
     }
 
-    bool loadFromFile(const std::string& path) {
-        std::ifstream file(path);
+    // Fallback for files that cannot be mapped (pipes, empty files, non-POSIX):
+    // parses every complete line of each block; only a line cut by the block
+    // end is carried over to the next read.
+    bool readFile(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
         if (!file) return false;
 
-        std::string line;
-        while (std::getline(file, line)) {
-            if (line.empty()) continue;
-            std::istringstream iss(line);
-            std::string cmd; iss >> cmd;
-            if (cmd.empty()) continue;
+        std::vector<char> buf(1 << 20);
+        size_t have = 0;
+        for (;;) {
+            if (have == buf.size()) buf.resize(buf.size() * 2);   // a line longer than the buffer
+            file.read(buf.data() + have, buf.size() - have);
+            const size_t got = (size_t)file.gcount();
+            have += got;
+            if (got == 0) { parse(buf.data(), buf.data() + have); break; }
 
-            if (cmd == "png") {
-                iss >> width >> height >> filename;
-            }
-            else if (cmd == "color") {
-                double r,g,b; iss >> r >> g >> b; current_color = Vec3(r,g,b);
+            const char* last = buf.data() + have;
+            while (last > buf.data() && last[-1] != '\n') --last;
+            parse(buf.data(), last);
+            have -= last - buf.data();
+            std::memmove(buf.data(), last, have);
+        }
+        return true;
+    }
+
+    // parses whole lines of scene text in [begin, end)
+    void parse(const char* begin, const char* end) {
+        while (begin < end) {
+            const char* nl = (const char*)std::memchr(begin, '\n', end - begin);
+            const char* eol = nl ? nl : end;
+            parseLine(begin, eol);
+            begin = nl ? nl + 1 : end;
+        }
+    }
+
+    static constexpr size_t PARALLEL_MIN_BYTES = 4 << 20;
+
+    // Two-pass parallel parse of [begin, end), same result as parse(). Pass one
+    // cuts the text into line-aligned chunks and parses each on its own into a
+    // SceneChunk. Pass two walks the chunks in file order, carrying the state
+    // the format threads through (color, texture, texcoord, vertex count), and
+    // applies it: inherited texcoords, negative tri indices, each tri's color
+    // and texture, and the other commands, which are replayed in order.
+    void parseParallel(const char* begin, const char* end, int threads) {
+        const int n = threads * 4;
+        std::vector<const char*> cut(n + 1, end);
+        cut[0] = begin;
+        for (int c = 1; c < n; ++c) {
+            const char* p = std::max(cut[c - 1], begin + (end - begin) * c / n);
+            const char* nl = p < end ? (const char*)std::memchr(p, '\n', end - p) : nullptr;
+            cut[c] = nl ? nl + 1 : end;
+        }
+        std::vector<SceneChunk> chunks(n);
+        WorkStealingPool(threads).run(n, [&](int c, int) { chunks[c].parse(cut[c], cut[c + 1]); });
+
+        size_t nv = mesh.vertices.size(), nt = mesh.tris.size();
+        for (const SceneChunk& c : chunks) { nv += c.vertices.size(); nt += c.tris.size(); }
+        mesh.vertices.reserve(nv); mesh.uvs.reserve(nv); mesh.tris.reserve(nt);
+
+        std::vector<std::pair<Vec3, const Texture*>> seg;
+        for (const SceneChunk& c : chunks) {
+            const int offset = (int)mesh.vertices.size();
+            mesh.vertices.insert(mesh.vertices.end(), c.vertices.begin(), c.vertices.end());
+            mesh.uvs.insert(mesh.uvs.end(), c.inheritedUV, std::pair<Real,Real>(cur_u, cur_v));
+            mesh.uvs.insert(mesh.uvs.end(), c.uvs.begin(), c.uvs.end());
+            if (c.hasUV) { cur_u = c.cur_u; cur_v = c.cur_v; }
+
+            // resolve every segment once, loading textures in file order
+            seg.clear();
+            for (const SceneChunk::Segment& s : c.segments) {
+                if (s.cmd == Command::Color) current_color = s.color;
+                else if (s.cmd == Command::Texture)
+                    current_tex = s.tex == "none" ? nullptr : getTexture(std::string(s.tex));
+                seg.emplace_back(current_color, current_tex);
             }
-            else if (cmd == "texture") {
-                std::string name; iss >> name;
-                if (name == "none") current_tex = nullptr;
-                else current_tex = getTexture(name);
+
+            for (const SceneChunk::RawTri& t : c.tris) {
+                const int count = offset + t.nv;
+                auto idx = [&](int k){ return k > 0 ? k-1 : count + k; };
+                int ia = idx(t.i), ib = idx(t.j), ic = idx(t.k);
+                if (ia>=0 && ib>=0 && ic>=0 && ia<count && ib<count && ic<count)
+                    mesh.addTriangle(ia, ib, ic, seg[t.segment].first, seg[t.segment].second);
             }
-            else if (cmd == "texcoord") {
-                iss >> cur_u >> cur_v; // for subsequent xyz
+
+            // none of these read or change the carried state except the color
+            const Vec3 color = current_color;
+            for (const SceneChunk::Line& l : c.lines) {
+                current_color = seg[l.segment].first;
+                parseLine(l.begin, l.end);
             }
-            else if (cmd == "xyz") {
-                double x,y,z; iss >> x >> y >> z;
-                xyz_vertices.emplace_back(x,y,z);
-                xyz_uvs.emplace_back(cur_u, cur_v); // capture current texcoord
+            current_color = color;
+        }
+    }
+
+    void parseLine(const char* begin, const char* end) {
+        LineTokens iss(begin, end);
+        std::string_view cmd; iss >> cmd;
+        if (cmd.empty()) return;
+
+        switch (commandOf(cmd)) {
+        case Command::Png:
+            iss >> width >> height >> filename;
+            break;
+        case Command::Color: {
+            double r,g,b; iss >> r >> g >> b; current_color = Vec3(r,g,b);
+            break;
+        }
+        case Command::Texture: {
+            std::string_view name; iss >> name;
+            if (name == "none") current_tex = nullptr;
+            else current_tex = getTexture(std::string(name));
+            break;
+        }
+        case Command::Texcoord:
+            iss >> cur_u >> cur_v; // for subsequent xyz
+            break;
+        case Command::Xyz: {
+            double x,y,z; iss >> x >> y >> z;
+            mesh.vertices.emplace_back(x,y,z);
+            mesh.uvs.emplace_back(cur_u, cur_v); // capture current texcoord
+            break;
+        }
+        case Command::Tri: {
+            auto idx = [&](int k){
+                if (k > 0) return k-1;                    // 1-based
+                return (int)mesh.vertices.size() + k;    // negative from back
+            };
+            int i,j,k; iss >> i >> j >> k;
+            int ia = idx(i), ib = idx(j), ic = idx(k);
+            const int nv = (int)mesh.vertices.size();
+            if (ia>=0 && ib>=0 && ic>=0 && ia<nv && ib<nv && ic<nv) {
+                mesh.addTriangle(ia, ib, ic, current_color, current_tex);
             }
-            else if (cmd == "tri") {
-                auto idx = [&](int k){
-                    if (k > 0) return k-1;                    // 1-based
-                    return (int)xyz_vertices.size() + k;      // negative from back
-                };
-                int i,j,k; iss >> i >> j >> k;
-                int ia = idx(i), ib = idx(j), ic = idx(k);
-                if (ia>=0 && ib>=0 && ic>=0 &&
-                    ia<(int)xyz_vertices.size() &&
-                    ib<(int)xyz_vertices.size() &&
-                    ic<(int)xyz_vertices.size()) {
-                    auto [u1,v1] = xyz_uvs[ia];
-                    auto [u2,v2] = xyz_uvs[ib];
-                    auto [u3,v3] = xyz_uvs[ic];
-                    objects.emplace_back(std::make_shared<Triangle>(
-                        xyz_vertices[ia], xyz_vertices[ib], xyz_vertices[ic],
-                        current_color, u1,v1, u2,v2, u3,v3, current_tex
-                    ));
+            break;
+        }
+        case Command::Sphere: {
+            double x,y,z,r; iss >> x >> y >> z >> r;
+            // 现阶段球仍使用 flat color；需要贴图时可很快加（我们已支持 Texture）
+            spheres.emplace_back(Vec3(x,y,z), r, current_color);
+            break;
+        }
+        case Command::Plane: {
+            double A,B,C,D; iss >> A >> B >> C >> D;
+            planes.emplace_back(A,B,C,D, current_color);
+            break;
+        }
+        case Command::Sun: {
+            double x,y,z; iss >> x >> y >> z; suns.push_back(Sun{ Vec3(x,y,z), current_color });
+            break;
+        }
+        case Command::Bulb: {
+            double x,y,z; iss >> x >> y >> z; bulbs.push_back(Bulb{ Vec3(x,y,z), current_color });
+            break;
+        }
+        case Command::Eye:     { double x,y,z; iss >> x >> y >> z; eye     = Vec3(x,y,z); break; }
+        case Command::Forward: { double x,y,z; iss >> x >> y >> z; forward = Vec3(x,y,z); break; }
+        case Command::Up:      { double x,y,z; iss >> x >> y >> z; up_hint = Vec3(x,y,z); break; }
+        case Command::Aa:      { int n; iss >> n; aa_samples = std::max(1, n); break; }
+        case Command::Bounces: { int d; iss >> d; bounces    = std::max(0, d); break; }
+        case Command::Sampler: {
+            std::string_view name; iss >> name;   // random | stratified | sobol
+            if (name == "random")          sampler = Sampler::Random;
+            else if (name == "stratified") sampler = Sampler::Stratified;
+            else if (name == "sobol")      sampler = Sampler::Sobol;
+            break;
+        }
+        case Command::Adaptive: {
+            double e; int n; iss >> e;   // adaptive <threshold> [base]
+            if (!(iss >> n)) n = 8;
+            adaptive_threshold = std::max(0.0, e); adaptive_base = std::max(2, n);
+            break;
+        }
+        case Command::Unknown:
+            break;
+        }
+    }
+
+    void buildAccel() {
+        mesh.build();
+        std::vector<AABB> boxes(spheres.size());
+        std::vector<int> ids(spheres.size());
+        for (size_t i = 0; i < spheres.size(); ++i) { boxes[i] = spheres[i].bounds(); ids[i] = (int)i; }
+        sphere_bvh.build(boxes, ids);
+    }
+
+    // closest hit in (t_min, t_max); surface data is built once, for the winner only
+    std::optional<HitInfo> intersect(const Ray& ray, Real t_min = 0,
+                                     Real t_max = std::numeric_limits<Real>::infinity()) const {
+        Hit best{ t_max };
+        auto take = [&](const std::optional<Hit>& hit, PrimKind kind, int i) {
+            if (!hit) return;
+            t_max = hit->t; best = *hit; best.kind = kind; best.prim = i;
+        };
+        for (int i = 0; i < (int)planes.size(); ++i)
+            take(planes[i].intersect(ray, t_min, t_max), PrimKind::Plane, i);
+        sphere_bvh.traverse(ray, t_min, t_max, [&](int i) {
+            take(spheres[i].intersect(ray, t_min, t_max), PrimKind::Sphere, i);
+            return false;
+        });
+        take(mesh.intersect(ray, t_min, t_max), PrimKind::Mesh, 0);
+
+        switch (best.kind) {
+            case PrimKind::Plane:  return planes[best.prim].surface(ray, best);
+            case PrimKind::Sphere: return spheres[best.prim].surface(ray, best);
+            case PrimKind::Mesh:   return mesh.surface(ray, best);
+            case PrimKind::None:   break;
+        }
+        return std::nullopt;
+    }
+
+    // closest hits for a packet of primary rays; out[i] is what intersect(p.rays[i])
+    // returns. Incoherent packets fall back to tracing each ray on its own.
+    void intersect(const RayPacket& p, std::optional<HitInfo> out[]) const {
+        if (!p.coherent()) {
+            for (int i = 0; i < p.count; ++i) out[i] = intersect(p.rays[i]);
+            return;
+        }
+        Real t_max[RayPacket::SIZE];
+        Hit best[RayPacket::SIZE];
+        std::fill(t_max, t_max + RayPacket::SIZE, -std::numeric_limits<Real>::infinity());
+        for (int i = 0; i < p.count; ++i) {
+            t_max[i] = std::numeric_limits<Real>::infinity();
+            best[i] = Hit{ t_max[i] };
+            for (int k = 0; k < (int)planes.size(); ++k)
+                if (auto hit = planes[k].intersect(p.rays[i], 0, t_max[i])) {
+                    t_max[i] = hit->t; best[i] = *hit; best[i].kind = PrimKind::Plane; best[i].prim = k;
+                }
+        }
+        sphere_bvh.traversePacket(p, 0, t_max, p.all(), [&](int ni, unsigned mask) {
+            const BVHNode& node = sphere_bvh.nodes[ni];
+            for (; mask; mask &= mask - 1) {
+                const int i = __builtin_ctz(mask);
+                for (int k = node.first; k < node.first + node.count; ++k) {
+                    const int s = sphere_bvh.prims[k];
+                    if (auto hit = spheres[s].intersect(p.rays[i], 0, t_max[i])) {
+                        t_max[i] = hit->t; best[i] = *hit; best[i].kind = PrimKind::Sphere; best[i].prim = s;
+                    }
                 }
             }
-            else if (cmd == "sphere") {
-                double x,y,z,r; iss >> x >> y >> z >> r;
-                // 现阶段球仍使用 flat color；需要贴图时可很快加（我们已支持 Texture）
-                objects.emplace_back(std::make_shared<Sphere>(Vec3(x,y,z), r, current_color));
-            }
-            else if (cmd == "plane") {
-                double A,B,C,D; iss >> A >> B >> C >> D;
-                objects.emplace_back(std::make_shared<Plane>(A,B,C,D, current_color));
-            }
-            else if (cmd == "sun") {
-                double x,y,z; iss >> x >> y >> z; suns.push_back(Sun{ Vec3(x,y,z), current_color });
+        });
+        mesh.intersect(p, 0, t_max, p.all(), best);
+
+        for (int i = 0; i < p.count; ++i) {
+            const Ray& ray = p.rays[i];
+            switch (best[i].kind) {
+                case PrimKind::Plane:  out[i] = planes[best[i].prim].surface(ray, best[i]); break;
+                case PrimKind::Sphere: out[i] = spheres[best[i].prim].surface(ray, best[i]); break;
+                case PrimKind::Mesh:   out[i] = mesh.surface(ray, best[i]); break;
+                case PrimKind::None:   out[i] = std::nullopt; break;
             }
-            else if (cmd == "bulb") {
-                double x,y,z; iss >> x >> y >> z; bulbs.push_back(Bulb{ Vec3(x,y,z), current_color });
+        }
+    }
+
+    // ray streams: cut into runs of RayPacket::SIZE, each traced as one packet,
+    // so streams laid out in 4x4 pixel blocks stay coherent
+    void intersect(const Ray* rays, int n, std::optional<HitInfo>* out) const {
+        for (int i = 0; i < n; i += RayPacket::SIZE) {
+            RayPacket p;
+            for (int k = i; k < std::min(i + RayPacket::SIZE, n); ++k) p.add(rays[k]);
+            intersect(p, out + i);
+        }
+    }
+
+    // true if anything blocks the ray in (0, t_max); stops at the first blocker
+    bool occluded(const Ray& ray, Real t_max) const {
+        for (const Plane& p : planes) if (p.occluded(ray, t_max)) return true;
+        if (sphere_bvh.traverse(ray, 0, t_max, [&](int i) { return spheres[i].occluded(ray, t_max); }))
+            return true;
+        return mesh.occluded(ray, t_max);
+    }
+
+    // shadow query for a packet: bit i is set when occluded(p.rays[i], t_max[i]) is true
+    unsigned occluded(const RayPacket& p, const Real t_max[]) const {
+        unsigned blocked = 0;
+        if (!p.coherent()) {
+            for (int i = 0; i < p.count; ++i)
+                if (occluded(p.rays[i], t_max[i])) blocked |= 1u << i;
+            return blocked;
+        }
+        for (int i = 0; i < p.count; ++i)
+            for (const Plane& pl : planes)
+                if (pl.occluded(p.rays[i], t_max[i])) { blocked |= 1u << i; break; }
+
+        Real live[RayPacket::SIZE];
+        for (int i = 0; i < RayPacket::SIZE; ++i)
+            live[i] = i >= p.count || (blocked >> i & 1) ? -std::numeric_limits<Real>::infinity() : t_max[i];
+        sphere_bvh.traversePacket(p, 0, live, p.all() & ~blocked, [&](int ni, unsigned mask) {
+            const BVHNode& node = sphere_bvh.nodes[ni];
+            for (; mask; mask &= mask - 1) {
+                const int i = __builtin_ctz(mask);
+                for (int k = node.first; k < node.first + node.count; ++k)
+                    if (spheres[sphere_bvh.prims[k]].occluded(p.rays[i], t_max[i])) {
+                        blocked |= 1u << i; live[i] = -std::numeric_limits<Real>::infinity();
+                        break;
+                    }
             }
-            else if (cmd == "eye")     { double x,y,z; iss >> x >> y >> z; eye     = Vec3(x,y,z); }
-            else if (cmd == "forward") { double x,y,z; iss >> x >> y >> z; forward = Vec3(x,y,z); }
-            else if (cmd == "up")      { double x,y,z; iss >> x >> y >> z; up_hint = Vec3(x,y,z); }
-            else if (cmd == "aa")      { int n; iss >> n; aa_samples = std::max(1, n); }
-            else if (cmd == "bounces") { int d; iss >> d; bounces    = std::max(0, d); }
+        });
+        return blocked | mesh.occluded(p, t_max, p.all() & ~blocked);
+    }
+
+    void occluded(const Ray* rays, const Real* t_max, int n, unsigned char* blocked) const {
+        for (int i = 0; i < n; i += RayPacket::SIZE) {
+            RayPacket p;
+            for (int k = i; k < std::min(i + RayPacket::SIZE, n); ++k) p.add(rays[k]);
+            const unsigned mask = occluded(p, t_max + i);
+            for (int k = 0; k < p.count; ++k) blocked[i + k] = mask >> k & 1;
         }
-        return true;
     }
 };
 
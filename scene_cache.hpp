@@ -0,0 +1,161 @@
+// scene_cache.hpp — versioned binary container for compiled scenes: a header,
+// the files it was built from, then 64-byte aligned flat arrays
+#ifndef SCENE_CACHE_HPP
+#define SCENE_CACHE_HPP
+
+#include "mapped_file.hpp"
+#include "flat_array.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// size and modification time of an input file; size -1 if it does not exist
+struct FileStamp {
+    int64_t size = -1, time = 0;
+
+    static FileStamp of(const std::string& path) {
+        FileStamp s;
+        std::error_code ec;
+        auto sz = std::filesystem::file_size(path, ec);
+        if (ec) return s;
+        auto t = std::filesystem::last_write_time(path, ec);
+        if (ec) return s;
+        s.size = (int64_t)sz;
+        s.time = (int64_t)t.time_since_epoch().count();
+        return s;
+    }
+    bool operator==(const FileStamp& o) const { return size == o.size && time == o.time; }
+};
+
+struct CacheHeader {
+    static constexpr uint32_t VERSION = 1;
+    char     magic[8] = { 'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0' };
+    uint32_t version  = VERSION;
+    uint32_t layout   = 0;   // hash of the build's struct sizes (Real, nodes, blocks, ...)
+
+    bool valid(uint32_t expect) const {
+        return !std::memcmp(magic, CacheHeader().magic, sizeof magic) && version == VERSION && layout == expect;
+    }
+};
+
+// memcpy-able: no pointers to fix up, no owned resources (std::pair qualifies
+// here even though its assignment operator makes it not trivially copyable)
+template <class T>
+constexpr bool rawCopyable = std::is_trivially_copy_constructible<T>::value &&
+                             std::is_trivially_destructible<T>::value && !std::is_pointer<T>::value;
+
+// Writes to a private temporary file and renames it over `path` on close(), so
+// processes that still have the old cache mapped keep reading the old inode
+// instead of a file being truncated under them.
+class CacheWriter {
+public:
+    static constexpr size_t ALIGN = 64;
+
+    explicit CacheWriter(const std::string& path)
+        : path(path), tmp(path + ".tmp." + std::to_string(processId())), f(std::fopen(tmp.c_str(), "wb")) {}
+    ~CacheWriter() { if (f) { std::fclose(f); std::remove(tmp.c_str()); } }
+    explicit operator bool() const { return f && ok; }
+
+    template <class T> void pod(const T& v) {
+        static_assert(rawCopyable<T>, "raw copy only");
+        bytes(&v, sizeof v);
+    }
+    void string(const std::string& s) { pod((uint64_t)s.size()); bytes(s.data(), s.size()); }
+
+    // count, padding up to ALIGN, then the elements as they sit in memory
+    template <class T> void array(const T* p, size_t n) {
+        static_assert(rawCopyable<T>, "raw copy only");
+        pod((uint64_t)n);
+        static const char zero[ALIGN] = {};
+        bytes(zero, (ALIGN - pos % ALIGN) % ALIGN);
+        bytes(p, n * sizeof(T));
+    }
+    template <class A> void array(const A& a) { array(a.data(), a.size()); }   // vector or FlatArray
+
+    bool close() {
+        bool good = f && ok && std::fclose(f) == 0;
+        f = nullptr;
+        if (good) good = std::rename(tmp.c_str(), path.c_str()) == 0;
+        if (!good) std::remove(tmp.c_str());
+        return good;
+    }
+
+private:
+    std::string path, tmp;
+    std::FILE* f;
+
+    static long processId() {
+#if defined(MAPPED_FILE_MMAP)
+        return (long)getpid();
+#else
+        return 0;
+#endif
+    }
+    size_t pos = 0;
+    bool ok = true;
+
+    void bytes(const void* p, size_t n) {
+        if (n && f && std::fwrite(p, 1, n, f) != n) ok = false;
+        pos += n;
+    }
+};
+
+// Reads a mapped cache in place; every read is bounds-checked and a short or
+// corrupt file just makes the reader fail.
+class CacheReader {
+public:
+    CacheReader(const char* data, size_t size): base(data), end(data + size), p(data) {}
+    explicit operator bool() const { return ok; }
+
+    template <class T> CacheReader& pod(T& v) {
+        if (take(sizeof v)) std::memcpy(&v, p - sizeof v, sizeof v);
+        return *this;
+    }
+    CacheReader& string(std::string& s) {
+        uint64_t n = 0; pod(n);
+        if (take(n)) s.assign(p - n, n);
+        return *this;
+    }
+
+    // pointer to n elements inside the mapping (nullptr on failure)
+    template <class T> const T* view(size_t& n) {
+        uint64_t count = 0; pod(count);
+        take((CacheWriter::ALIGN - (p - base) % CacheWriter::ALIGN) % CacheWriter::ALIGN);
+        if (!ok || count > (uint64_t)(end - p) / sizeof(T)) { ok = false; n = 0; return nullptr; }
+        const T* v = (const T*)p;
+        p += count * sizeof(T); n = (size_t)count;
+        return v;
+    }
+    template <class T> CacheReader& array(std::vector<T>& out) {
+        size_t n = 0;
+        const T* v = view<T>(n);
+        if (v) out.assign(v, v + n);
+        return *this;
+    }
+    // no copy: out views the mapping, which must outlive it
+    template <class T> CacheReader& map(FlatArray<T>& out) {
+        size_t n = 0;
+        const T* v = view<T>(n);
+        if (v && (uintptr_t)v % alignof(T)) ok = false;   // mapping not page aligned
+        if (ok) out.view(v, n);
+        return *this;
+    }
+
+private:
+    const char* base;
+    const char* end;
+    const char* p;
+    bool ok = true;
+
+    bool take(uint64_t n) {
+        if (!ok || n > (uint64_t)(end - p)) { ok = false; return false; }
+        p += n;
+        return true;
+    }
+};
+
+#endif // SCENE_CACHE_HPP
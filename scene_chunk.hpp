@@ -0,0 +1,96 @@
+// scene_chunk.hpp — first pass of the parallel scene parser: one chunk of lines,
+// parsed without knowing the state (color, texture, texcoord, vertex count)
+// that the lines before it leave behind
+#ifndef SCENE_CHUNK_HPP
+#define SCENE_CHUNK_HPP
+
+#include "tokenizer.hpp"
+#include "vec3.hpp"
+#include <cstring>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct SceneChunk {
+    // A segment starts at every color or texture line and changes just that;
+    // tris and rare lines refer to the segment they were read in. Segment 0 is
+    // the state the chunk inherits.
+    struct Segment {
+        Command cmd = Command::Unknown;  // Color, Texture, or Unknown for segment 0
+        Vec3 color;
+        std::string_view tex;            // texture name as written, loaded in the second pass
+    };
+    struct RawTri {
+        int i, j, k;      // indices as written
+        int nv;           // vertices read by this chunk so far, for negative indices
+        int segment;
+    };
+    struct Line {         // any other command, replayed in the second pass
+        const char* begin;
+        const char* end;
+        int segment;
+    };
+
+    std::vector<Vec3> vertices;
+    std::vector<std::pair<Real,Real>> uvs;
+    int inheritedUV = 0;          // leading vertices read before the chunk's first texcoord
+    bool hasUV = false;
+    double cur_u = 0, cur_v = 0;  // last texcoord of the chunk, if hasUV
+    std::vector<Segment> segments = std::vector<Segment>(1);
+    std::vector<RawTri> tris;
+    std::vector<Line> lines;
+
+    void parse(const char* begin, const char* end) {
+        while (begin < end) {
+            const char* nl = (const char*)std::memchr(begin, '\n', end - begin);
+            const char* eol = nl ? nl : end;
+            parseLine(begin, eol);
+            begin = nl ? nl + 1 : end;
+        }
+    }
+
+private:
+    // Same reads as Scene::parseLine, into chunk-local state.
+    void parseLine(const char* begin, const char* end) {
+        LineTokens iss(begin, end);
+        std::string_view cmd; iss >> cmd;
+        if (cmd.empty()) return;
+
+        switch (commandOf(cmd)) {
+        case Command::Xyz: {
+            double x,y,z; iss >> x >> y >> z;
+            vertices.emplace_back(x,y,z);
+            if (hasUV) uvs.emplace_back(cur_u, cur_v);
+            else       ++inheritedUV;
+            break;
+        }
+        case Command::Tri: {
+            int i,j,k; iss >> i >> j >> k;
+            tris.push_back(RawTri{ i, j, k, (int)vertices.size(), (int)segments.size() - 1 });
+            break;
+        }
+        case Command::Texcoord:
+            iss >> cur_u >> cur_v;
+            hasUV = true;
+            break;
+        case Command::Color: {
+            double r,g,b; iss >> r >> g >> b;
+            segments.push_back(Segment{ Command::Color, Vec3(r,g,b), {} });
+            break;
+        }
+        case Command::Texture: {
+            Segment s{ Command::Texture };
+            iss >> s.tex;
+            segments.push_back(s);
+            break;
+        }
+        case Command::Unknown:
+            break;
+        default:
+            lines.push_back(Line{ begin, end, (int)segments.size() - 1 });
+            break;
+        }
+    }
+};
+
+#endif // SCENE_CHUNK_HPP
@@ -0,0 +1,73 @@
+// scheduler.hpp — fixed-size work-stealing pool for independent render tasks
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(int threads)
+        : n(std::max(1, threads)), queues(n) {}
+
+    static int defaultThreads() {
+        unsigned hc = std::thread::hardware_concurrency();
+        return hc == 0 ? 1 : (int)hc;
+    }
+
+    int size() const { return n; }
+
+    // Runs task(i, worker) for every i in [0, count) and returns when all are done.
+    // Tasks are dealt round-robin; each worker drains its own queue from the back
+    // and steals from the front of the others once it runs dry.
+    void run(int count, const std::function<void(int, int)>& task) {
+        for (int i = 0; i < count; ++i) queues[i % n].tasks.push_back(i);
+
+        if (n == 1) { work(0, task); return; }
+
+        std::vector<std::thread> workers;
+        workers.reserve(n - 1);
+        for (int w = 1; w < n; ++w) workers.emplace_back([&, w]{ work(w, task); });
+        work(0, task);
+        for (auto& t : workers) t.join();
+    }
+
+private:
+    struct Queue {
+        std::mutex m;
+        std::deque<int> tasks;
+    };
+
+    int n;
+    std::vector<Queue> queues;
+
+    bool popLocal(int w, int& out) {
+        std::lock_guard<std::mutex> lock(queues[w].m);
+        if (queues[w].tasks.empty()) return false;
+        out = queues[w].tasks.back(); queues[w].tasks.pop_back();
+        return true;
+    }
+
+    bool steal(int w, int& out) {
+        for (int k = 1; k < n; ++k) {
+            Queue& q = queues[(w + k) % n];
+            std::lock_guard<std::mutex> lock(q.m);
+            if (q.tasks.empty()) continue;
+            out = q.tasks.front(); q.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    // no task ever spawns another, so once every queue is empty the worker is done
+    void work(int w, const std::function<void(int, int)>& task) {
+        int i;
+        while (popLocal(w, i) || steal(w, i)) task(i, w);
+    }
+};
+
+#endif // SCHEDULER_HPP
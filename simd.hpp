@@ -0,0 +1,72 @@
+// simd.hpp — four-lane Real vectors behind one small set of wrappers
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include "vec3.hpp"
+
+// Four lanes per register: doubles need AVX (__m256d), floats only SSE (__m128).
+// A double build for x86 without -mavx still compiles the AVX wrappers, for
+// functions marked SIMD_TARGET, and kernels check simdAvailable() at run time
+// before calling them; with -mavx the check is a constant and folds away.
+#if !defined(RAYTRACER_FLOAT) && (defined(__AVX__) || \
+    (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))))
+#define SIMD4 1
+#include <immintrin.h>
+#if defined(__AVX__)
+#define SIMD_TARGET
+constexpr bool simdAvailable() { return true; }
+#else
+#define SIMD_TARGET __attribute__((target("avx")))
+inline const bool SIMD_AVX = (__builtin_cpu_init(), __builtin_cpu_supports("avx"));
+inline bool simdAvailable() { return SIMD_AVX; }
+#endif
+using VReal = __m256d;
+SIMD_TARGET inline VReal vset(Real x)               { return _mm256_set1_pd(x); }
+SIMD_TARGET inline VReal vload(const Real* p)       { return _mm256_load_pd(p); }
+SIMD_TARGET inline VReal vloadu(const Real* p)      { return _mm256_loadu_pd(p); }
+SIMD_TARGET inline void  vstore(Real* p, VReal a)   { _mm256_storeu_pd(p, a); }
+SIMD_TARGET inline VReal vadd(VReal a, VReal b)     { return _mm256_add_pd(a, b); }
+SIMD_TARGET inline VReal vsub(VReal a, VReal b)     { return _mm256_sub_pd(a, b); }
+SIMD_TARGET inline VReal vmul(VReal a, VReal b)     { return _mm256_mul_pd(a, b); }
+SIMD_TARGET inline VReal vdiv(VReal a, VReal b)     { return _mm256_div_pd(a, b); }
+SIMD_TARGET inline VReal vmin(VReal a, VReal b)     { return _mm256_min_pd(a, b); }
+SIMD_TARGET inline VReal vmax(VReal a, VReal b)     { return _mm256_max_pd(a, b); }
+SIMD_TARGET inline VReal vor(VReal a, VReal b)      { return _mm256_or_pd(a, b); }
+SIMD_TARGET inline VReal vsqrt(VReal a)             { return _mm256_sqrt_pd(a); }
+SIMD_TARGET inline VReal vabs(VReal a)              { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+SIMD_TARGET inline VReal vlt(VReal a, VReal b)      { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+SIMD_TARGET inline VReal vgt(VReal a, VReal b)      { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+SIMD_TARGET inline VReal vle(VReal a, VReal b)      { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+SIMD_TARGET inline VReal vge(VReal a, VReal b)      { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+SIMD_TARGET inline int   vmask(VReal a)             { return _mm256_movemask_pd(a); }
+#elif defined(RAYTRACER_FLOAT) && defined(__SSE__)
+#define SIMD4 1
+#include <immintrin.h>
+#define SIMD_TARGET
+constexpr bool simdAvailable() { return true; }
+using VReal = __m128;
+inline VReal vset(Real x)               { return _mm_set1_ps(x); }
+inline VReal vload(const Real* p)       { return _mm_load_ps(p); }
+inline VReal vloadu(const Real* p)      { return _mm_loadu_ps(p); }
+inline void  vstore(Real* p, VReal a)   { _mm_storeu_ps(p, a); }
+inline VReal vadd(VReal a, VReal b)     { return _mm_add_ps(a, b); }
+inline VReal vsub(VReal a, VReal b)     { return _mm_sub_ps(a, b); }
+inline VReal vmul(VReal a, VReal b)     { return _mm_mul_ps(a, b); }
+inline VReal vdiv(VReal a, VReal b)     { return _mm_div_ps(a, b); }
+inline VReal vmin(VReal a, VReal b)     { return _mm_min_ps(a, b); }
+inline VReal vmax(VReal a, VReal b)     { return _mm_max_ps(a, b); }
+inline VReal vor(VReal a, VReal b)      { return _mm_or_ps(a, b); }
+inline VReal vsqrt(VReal a)             { return _mm_sqrt_ps(a); }
+inline VReal vabs(VReal a)              { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+inline VReal vlt(VReal a, VReal b)      { return _mm_cmplt_ps(a, b); }
+inline VReal vgt(VReal a, VReal b)      { return _mm_cmpgt_ps(a, b); }
+inline VReal vle(VReal a, VReal b)      { return _mm_cmple_ps(a, b); }
+inline VReal vge(VReal a, VReal b)      { return _mm_cmpge_ps(a, b); }
+inline int   vmask(VReal a)             { return _mm_movemask_ps(a); }
+#endif
+
+// vmin(a, b) / vmax(a, b) return b when either side is NaN, so
+// std::min(x, y) == vmin(y, x) and std::max(x, y) == vmax(y, x).
+constexpr int VLANES = 4;
+
+#endif // SIMD_HPP
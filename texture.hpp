@@ -3,6 +3,7 @@
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include <array>
 #include <string>
 #include <vector>
 #include <cmath>
@@ -28,6 +29,19 @@ public:
         return true;
     }
 
+    // sRGB byte -> linear, built once; sampling is then a table fetch instead of pow()
+    static const std::array<Real, 256>& srgbToLinear() {
+        static const std::array<Real, 256> lut = [] {
+            std::array<Real, 256> t{};
+            for (int i = 0; i < 256; ++i) {
+                double s = i / 255.0;
+                t[i] = (s <= 0.04045) ? (s/12.92) : std::pow((s+0.055)/1.055, 2.4);
+            }
+            return t;
+        }();
+        return lut;
+    }
+
     // sample (u,v) in [0,1], wrap repeat; return **linear** Vec3
     Vec3 sample(double u, double v) const {
         if (w<=0 || h<=0) return Vec3(1,0,1); // debug magenta
@@ -36,14 +50,8 @@ public:
         int ix = std::clamp((int)std::floor(u * w), 0, w-1);
         int iy = std::clamp((int)std::floor((1.0 - v) * h), 0, h-1); // v top->bottom
         size_t idx = ((size_t)iy*w + ix) * 4;
-        auto toLinear = [](double s)->double {
-            s = std::clamp(s, 0.0, 1.0);
-            return (s <= 0.04045) ? (s/12.92) : std::pow((s+0.055)/1.055, 2.4);
-        };
-        double sr = data[idx+0] / 255.0;
-        double sg = data[idx+1] / 255.0;
-        double sb = data[idx+2] / 255.0;
-        return Vec3(toLinear(sr), toLinear(sg), toLinear(sb));
+        const auto& lut = srgbToLinear();
+        return Vec3(lut[data[idx+0]], lut[data[idx+1]], lut[data[idx+2]]);
     }
 };
 
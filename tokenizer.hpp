@@ -0,0 +1,95 @@
+// tokenizer.hpp — allocation-free reading of scene lines and command lookup
+#ifndef TOKENIZER_HPP
+#define TOKENIZER_HPP
+
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Reads whitespace-separated values from one line in place, with the same
+// chaining as std::istringstream: `in >> x >> y >> z`. A missing or malformed
+// value reads as 0 (or empty) and fails the rest of the line, which is what
+// the stream did for every value in our files.
+class LineTokens {
+public:
+    LineTokens(const char* begin, const char* end): p(begin), end(end) {}
+
+    explicit operator bool() const { return ok; }
+
+    LineTokens& operator>>(std::string_view& w) {
+        skipSpace();
+        const char* s = p;
+        while (p < end && !isSpace(*p)) ++p;
+        w = std::string_view(s, p - s);
+        if (w.empty()) ok = false;
+        return *this;
+    }
+    LineTokens& operator>>(std::string& w) {
+        std::string_view v; *this >> v; w.assign(v.data(), v.size());
+        return *this;
+    }
+    LineTokens& operator>>(double& x) { return number(x); }
+    LineTokens& operator>>(float& x)  { return number(x); }
+    LineTokens& operator>>(int& x)    { return number(x); }
+
+private:
+    const char* p;
+    const char* end;
+    bool ok = true;
+
+    static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; }
+    void skipSpace() { while (p < end && isSpace(*p)) ++p; }
+
+    template <class T>
+    LineTokens& number(T& x) {
+        x = 0;
+        if (!ok) return *this;
+        skipSpace();
+        const char* s = p;
+        if (s < end && *s == '+') ++s;          // from_chars takes '-' but not '+'
+        auto [q, ec] = std::from_chars(s, end, x);
+        if (ec != std::errc()) { x = 0; ok = false; p = end; return *this; }
+        p = q;
+        return *this;
+    }
+};
+
+// FNV-1a; distinct commands get distinct keys (duplicate case labels would not compile)
+constexpr uint32_t commandKey(std::string_view s) {
+    uint32_t h = 2166136261u;
+    for (char c : s) { h ^= (uint8_t)c; h *= 16777619u; }
+    return h;
+}
+
+enum class Command : uint8_t {
+    Unknown, Png, Color, Texture, Texcoord, Xyz, Tri, Sphere, Plane, Sun, Bulb,
+    Eye, Forward, Up, Aa, Bounces, Sampler, Adaptive
+};
+
+// the key picks the only possible command, one compare confirms it
+inline Command commandOf(std::string_view w) {
+    auto is = [&](std::string_view name, Command c) { return w == name ? c : Command::Unknown; };
+    switch (commandKey(w)) {
+        case commandKey("xyz"):      return is("xyz", Command::Xyz);
+        case commandKey("tri"):      return is("tri", Command::Tri);
+        case commandKey("texcoord"): return is("texcoord", Command::Texcoord);
+        case commandKey("color"):    return is("color", Command::Color);
+        case commandKey("texture"):  return is("texture", Command::Texture);
+        case commandKey("sphere"):   return is("sphere", Command::Sphere);
+        case commandKey("plane"):    return is("plane", Command::Plane);
+        case commandKey("sun"):      return is("sun", Command::Sun);
+        case commandKey("bulb"):     return is("bulb", Command::Bulb);
+        case commandKey("png"):      return is("png", Command::Png);
+        case commandKey("eye"):      return is("eye", Command::Eye);
+        case commandKey("forward"):  return is("forward", Command::Forward);
+        case commandKey("up"):       return is("up", Command::Up);
+        case commandKey("aa"):       return is("aa", Command::Aa);
+        case commandKey("bounces"):  return is("bounces", Command::Bounces);
+        case commandKey("sampler"):  return is("sampler", Command::Sampler);
+        case commandKey("adaptive"): return is("adaptive", Command::Adaptive);
+    }
+    return Command::Unknown;
+}
+
+#endif // TOKENIZER_HPP
@@ -1,63 +1,51 @@
 #ifndef TRIANGLE_HPP
 #define TRIANGLE_HPP
 
-#include "object.hpp"
-#include "texture.hpp"
+#include "ray.hpp"
 #include <cmath>
 
-class Triangle : public Object {
-public:
-    Vec3 a, b, c;           // positions
-    Vec3 color;             // flat color when no texture
-    // per-vertex uv captured at xyz time
-    double ua, va, ub, vb, uc, vc;
-    std::shared_ptr<Texture> tex; // optional
-
-    Triangle(const Vec3& A, const Vec3& B, const Vec3& C,
-             const Vec3& col,
-             double uA, double vA, double uB, double vB, double uC, double vC,
-             std::shared_ptr<Texture> T)
-        : a(A), b(B), c(C), color(col),
-          ua(uA), va(vA), ub(uB), vb(vB), uc(uC), vc(vC),
-          tex(std::move(T)) {}
-
-    std::optional<HitInfo> intersect(const Ray& ray) const override {
-        constexpr double EPS = 1e-9;
-        Vec3 e1 = b - a, e2 = c - a;
-        Vec3 p  = ray.direction.cross(e2);
-        double det = e1.dot(p);
-        if (std::fabs(det) < EPS) return std::nullopt;
-        double invDet = 1.0 / det;
-
-        Vec3 tvec = ray.origin - a;
-        double u = tvec.dot(p) * invDet;
-        if (u < -EPS || u > 1.0 + EPS) return std::nullopt;
-
-        Vec3 qvec = tvec.cross(e1);
-        double v = ray.direction.dot(qvec) * invDet;
-        if (v < -EPS || (u + v) > 1.0 + EPS) return std::nullopt;
-
-        double t = e2.dot(qvec) * invDet;
-        if (t <= EPS) return std::nullopt;
-
-        HitInfo h;
-        h.t = t;
-        h.point = ray.at(t);
-        Vec3 gn = e1.cross(e2).normalized();
-        h.set_face_normal(ray, gn);
-        h.color = color;
-        h.tex = tex;
-
-        if (h.tex) {
-            double w = 1.0 - u - v;     // barycentric weights
-            h.u = w*ua + u*ub + v*uc;
-            h.v = w*va + u*vb + v*vc;
-
-            // 关键：把三角形的 v 翻转一下，匹配你当前的 Texture::sample 约定
-            // （Texture::sample 里用的是 iy = floor((1 - v) * h)）
-            h.v = 1.0 - h.v;
-        }
-        return h;
-    }
-};
+// Tolerance for barycentrics and t, and for det relative to |d||e1||e2| (the
+// ray's angle to the triangle's plane); float needs a looser one than double.
+constexpr Real TRI_EPS = sizeof(Real) == sizeof(float) ? Real(1e-7) : Real(1e-9);
+
+// Möller–Trumbore against a triangle given as (a, e1 = b - a, e2 = c - a).
+// Accepts t in (t_min, t_max); u, v are the barycentrics of b and c.
+// The parallel test scales with the triangle, so tiny geometry is kept, and
+// rejects degenerate (zero-edge) triangles since det is 0 there.
+inline bool intersectTriangle(const Ray& ray, const Vec3& a, const Vec3& e1, const Vec3& e2,
+                              Real t_min, Real t_max, Real& t, Real& u, Real& v) {
+    constexpr Real EPS = TRI_EPS;
+    Vec3 p  = ray.direction.cross(e2);
+    Real det = e1.dot(p);
+    Real scale = std::sqrt(ray.direction.lengthSquared() * e1.lengthSquared() * e2.lengthSquared());
+    if (std::fabs(det) <= EPS * scale) return false;
+    Real invDet = Real(1) / det;
+
+    Vec3 tvec = ray.origin - a;
+    u = tvec.dot(p) * invDet;
+    if (u < -EPS || u > Real(1) + EPS) return false;
+
+    // distance before the second barycentric: most candidates behind the
+    // current best hit are rejected here
+    Vec3 qvec = tvec.cross(e1);
+    t = e2.dot(qvec) * invDet;
+    if (t <= EPS || t <= t_min || t >= t_max) return false;
+
+    v = ray.direction.dot(qvec) * invDet;
+    return !(v < -EPS || (u + v) > Real(1) + EPS);
+}
+
+// interpolate per-vertex texcoords at barycentrics (u, v)
+inline void interpolateUV(Real u, Real v,
+                          Real ua, Real va, Real ub, Real vb, Real uc, Real vc,
+                          Real& out_u, Real& out_v) {
+    Real w = Real(1) - u - v; // barycentric weights
+    out_u = w*ua + u*ub + v*uc;
+    out_v = w*va + u*vb + v*vc;
+
+    // 关键：把三角形的 v 翻转一下，匹配你当前的 Texture::sample 约定
+    // （Texture::sample 里用的是 iy = floor((1 - v) * h)）
+    out_v = Real(1) - out_v;
+}
+
 #endif // TRIANGLE_HPP
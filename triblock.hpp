@@ -0,0 +1,118 @@
+// triblock.hpp — SoA block of triangles and a one-ray-vs-LANES-triangles Möller–Trumbore kernel
+#ifndef TRIBLOCK_HPP
+#define TRIBLOCK_HPP
+
+#include "triangle.hpp"
+#include "simd.hpp"
+
+// One BVH leaf worth of triangles, vertex a and both edges split per component.
+// Unused lanes have zero edges, so det == 0 rejects them.
+struct alignas(32) TriBlock {
+    static constexpr int LANES = 4;
+
+    Real ax[LANES],  ay[LANES],  az[LANES];
+    Real e1x[LANES], e1y[LANES], e1z[LANES];
+    Real e2x[LANES], e2y[LANES], e2z[LANES];
+    int    face[LANES];  // triangle index per lane, -1 when unused
+
+    TriBlock() {
+        for (int i = 0; i < LANES; ++i) {
+            ax[i] = ay[i] = az[i] = e1x[i] = e1y[i] = e1z[i] = e2x[i] = e2y[i] = e2z[i] = 0.0;
+            face[i] = -1;
+        }
+    }
+
+    void set(int lane, int f, const Vec3& a, const Vec3& e1, const Vec3& e2) {
+        face[lane] = f;
+        ax[lane]  = a.x;  ay[lane]  = a.y;  az[lane]  = a.z;
+        e1x[lane] = e1.x; e1y[lane] = e1.y; e1z[lane] = e1.z;
+        e2x[lane] = e2.x; e2y[lane] = e2.y; e2z[lane] = e2.z;
+    }
+
+    // an unused lane: no face and all-zero geometry, so the kernel rejects it
+    bool unused(int lane) const {
+        return face[lane] == -1 &&
+               ax[lane] == 0 && ay[lane] == 0 && az[lane] == 0 &&
+               e1x[lane] == 0 && e1y[lane] == 0 && e1z[lane] == 0 &&
+               e2x[lane] == 0 && e2y[lane] == 0 && e2z[lane] == 0;
+    }
+
+    // Tests the ray against all lanes at once; returns a bitmask of lanes hit in
+    // (t_min, t_max) and their t, u, v. The arithmetic is the same, operation for
+    // operation, as intersectTriangle(), so both paths accept the same hits.
+    int intersect(const Ray& ray, Real t_min, Real t_max,
+                  Real t[LANES], Real u[LANES], Real v[LANES]) const {
+#if defined(SIMD4)
+        if (simdAvailable()) return intersectSimd(ray, t_min, t_max, t, u, v);
+#endif
+        int mask = 0;
+        for (int i = 0; i < LANES; ++i) {
+            Vec3 e1(e1x[i], e1y[i], e1z[i]), e2(e2x[i], e2y[i], e2z[i]);
+            if (intersectTriangle(ray, Vec3(ax[i], ay[i], az[i]), e1, e2, t_min, t_max, t[i], u[i], v[i]))
+                mask |= 1 << i;
+        }
+        return mask;
+    }
+
+#if defined(SIMD4)
+    SIMD_TARGET int intersectSimd(const Ray& ray, Real t_min, Real t_max,
+                                  Real t[LANES], Real u[LANES], Real v[LANES]) const {
+        const VReal dx = vset(ray.direction.x), dy = vset(ray.direction.y), dz = vset(ray.direction.z);
+        const VReal E1x = vload(e1x), E1y = vload(e1y), E1z = vload(e1z);
+        const VReal E2x = vload(e2x), E2y = vload(e2y), E2z = vload(e2z);
+
+        // p = d x e2, det = e1 . p
+        VReal px = vsub(vmul(dy, E2z), vmul(dz, E2y));
+        VReal py = vsub(vmul(dz, E2x), vmul(dx, E2z));
+        VReal pz = vsub(vmul(dx, E2y), vmul(dy, E2x));
+        VReal det = vadd(vadd(vmul(E1x, px), vmul(E1y, py)), vmul(E1z, pz));
+        // |det| <= eps |d||e1||e2|, as in intersectTriangle()
+        VReal e11 = vadd(vadd(vmul(E1x, E1x), vmul(E1y, E1y)), vmul(E1z, E1z));
+        VReal e22 = vadd(vadd(vmul(E2x, E2x), vmul(E2y, E2y)), vmul(E2z, E2z));
+        VReal scale = vsqrt(vmul(vmul(vset(ray.direction.lengthSquared()), e11), e22));
+        VReal reject = vle(vabs(det), vmul(vset(TRI_EPS), scale));
+        VReal invDet = vdiv(vset(Real(1)), det);
+
+        // tvec = o - a, u = (tvec . p) / det
+        VReal tx = vsub(vset(ray.origin.x), vload(ax));
+        VReal ty = vsub(vset(ray.origin.y), vload(ay));
+        VReal tz = vsub(vset(ray.origin.z), vload(az));
+        VReal U = vmul(vadd(vadd(vmul(tx, px), vmul(ty, py)), vmul(tz, pz)), invDet);
+        const VReal lo = vset(-TRI_EPS), hi = vset(Real(1) + TRI_EPS);
+        reject = vor(reject, vor(vlt(U, lo), vgt(U, hi)));
+
+        // qvec = tvec x e1, t = (e2 . qvec) / det, v = (d . qvec) / det
+        VReal qx = vsub(vmul(ty, E1z), vmul(tz, E1y));
+        VReal qy = vsub(vmul(tz, E1x), vmul(tx, E1z));
+        VReal qz = vsub(vmul(tx, E1y), vmul(ty, E1x));
+        VReal T = vmul(vadd(vadd(vmul(E2x, qx), vmul(E2y, qy)), vmul(E2z, qz)), invDet);
+        reject = vor(reject, vle(T, vset(TRI_EPS)));
+        reject = vor(reject, vor(vle(T, vset(t_min)), vge(T, vset(t_max))));
+        VReal V = vmul(vadd(vadd(vmul(dx, qx), vmul(dy, qy)), vmul(dz, qz)), invDet);
+        reject = vor(reject, vor(vlt(V, lo), vgt(vadd(U, V), hi)));
+
+        vstore(t, T); vstore(u, U); vstore(v, V);
+        return ~vmask(reject) & ((1 << LANES) - 1);
+    }
+#endif
+
+    // closest accepted lane (lowest lane wins ties, like a sequential scan); -1 if none
+    int closest(const Ray& ray, Real t_min, Real t_max, Real& t, Real& u, Real& v) const {
+        Real T[LANES], U[LANES], V[LANES];
+        int mask = intersect(ray, t_min, t_max, T, U, V);
+        int best = -1;
+        for (int i = 0; i < LANES; ++i)
+            if (((mask >> i) & 1) && (best < 0 || T[i] < T[best])) best = i;
+        if (best >= 0) { t = T[best]; u = U[best]; v = V[best]; }
+        return best;
+    }
+
+    bool any(const Ray& ray, Real t_max) const {
+        Real T[LANES], U[LANES], V[LANES];
+        return intersect(ray, 0.0, t_max, T, U, V) != 0;
+    }
+};
+
+static_assert(TriBlock::LANES == VLANES, "the AVX kernel is written for 4 Real lanes");
+
+#endif // TRIBLOCK_HPP
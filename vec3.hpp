@@ -4,34 +4,42 @@
 #include <cmath>
 #include <iostream>
 
+// Scalar type for geometry and shading. Build with -DRAYTRACER_FLOAT (make FLOAT=1)
+// to run in single precision; double stays the default.
+#ifdef RAYTRACER_FLOAT
+using Real = float;
+#else
+using Real = double;
+#endif
+
 class Vec3 {
 public:
-    double x, y, z;
+    Real x, y, z;
 
     Vec3(): x(0), y(0), z(0) {}
-    Vec3(double x, double y, double z): x(x), y(y), z(z) {}
+    Vec3(Real x, Real y, Real z): x(x), y(y), z(z) {}
 
     Vec3 operator+(const Vec3& v) const { return Vec3(x + v.x, y + v.y, z + v.z); }
     Vec3 operator-(const Vec3& v) const { return Vec3(x - v.x, y - v.y, z - v.z); }
-    Vec3 operator*(double s)     const { return Vec3(x * s, y * s, z * s); }
-    Vec3 operator/(double s)     const { return Vec3(x / s, y / s, z / s); }
+    Vec3 operator*(Real s)     const { return Vec3(x * s, y * s, z * s); }
+    Vec3 operator/(Real s)     const { return Vec3(x / s, y / s, z / s); }
 
     Vec3& operator+=(const Vec3& v) { x += v.x; y += v.y; z += v.z; return *this; }
     Vec3& operator-=(const Vec3& v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
-    Vec3& operator*=(double s)      { x *= s; y *= s; z *= s; return *this; }
-    Vec3& operator/=(double s)      { x /= s; y /= s; z /= s; return *this; }
+    Vec3& operator*=(Real s)      { x *= s; y *= s; z *= s; return *this; }
+    Vec3& operator/=(Real s)      { x /= s; y /= s; z /= s; return *this; }
 
     Vec3 operator-() const { return Vec3(-x, -y, -z); }
 
-    double length() const { return std::sqrt(x*x + y*y + z*z); }
-    double lengthSquared() const { return x*x + y*y + z*z; }
+    Real length() const { return std::sqrt(x*x + y*y + z*z); }
+    Real lengthSquared() const { return x*x + y*y + z*z; }
 
     Vec3 normalized() const {
-        double len = length();
+        Real len = length();
         return len == 0 ? Vec3(0, 0, 0) : (*this) / len;
     }
 
-    double dot(const Vec3& v) const { return x*v.x + y*v.y + z*v.z; }
+    Real dot(const Vec3& v) const { return x*v.x + y*v.y + z*v.z; }
     Vec3 cross(const Vec3& v) const {
         return Vec3(
             y * v.z - z * v.y,
@@ -43,7 +51,7 @@ public:
     void print() const { std::cout << "(" << x << ", " << y << ", " << z << ")\n"; }
 };
 
-inline Vec3 operator*(double s, const Vec3& v) {
+inline Vec3 operator*(Real s, const Vec3& v) {
     return Vec3(s * v.x, s * v.y, s * v.z);
 }
 